@@ -0,0 +1,248 @@
+//
+//  ActionSlots.h
+//  Tilemap
+//
+//  An action manager addressed by integer handles instead of string keys.
+//
+
+#ifndef __ACTION_SLOTS_H__
+#define __ACTION_SLOTS_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <memory>
+#include <functional>
+
+using namespace cugl;
+
+/**
+ * This class animates scene graph actions like the CUGL action manager, but
+ * every action is addressed by a handle instead of a string key.
+ *
+ * An entity reserves its handles once, when it is created, and keeps them.
+ * A handle is an index into a table of slots, so starting, stopping and
+ * querying an action is an array access, with no key to build or hash. The
+ * running actions are also kept in a dense list, so an update only visits
+ * those.
+ *
+ * Each handle runs at most one action at a time. The handles stay valid
+ * until the manager is disposed; entities created afterwards reserve new
+ * ones.
+ */
+class ActionSlots {
+
+#pragma mark Constants
+public:
+    /** Identifies a slot of the manager */
+    typedef int Handle;
+    /** A handle that belongs to no slot */
+    static constexpr Handle NO_HANDLE = -1;
+
+#pragma mark Internal References
+private:
+    /** The action of one handle, the same as an action instance in CUGL */
+    struct Slot {
+        /** The node the action is performed on */
+        std::shared_ptr<scene2::SceneNode> target;
+        /** The action template, nullptr while the slot is idle */
+        std::shared_ptr<scene2::Action> action;
+        /** The interpolation function on [0,1] to allow non-linear behavior */
+        std::function<float(float)> interpolant;
+        /** Any internal state needed by this action */
+        void* state;
+        /** The execution time since the action started */
+        float elapsed;
+        /** Position of the slot in _running, -1 while idle */
+        int running;
+    };
+
+    /** Every reserved slot, by handle */
+    std::vector<Slot> _slots;
+    /** Handles of the slots with an action, in no particular order */
+    std::vector<Handle> _running;
+
+#pragma mark Constructors
+public:
+    /**
+     * Creates a new action manager with no slots.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate an object on
+     * the heap, use one of the static constructors instead.
+     */
+    ActionSlots() {}
+
+    /**
+     * Deletes this action manager, disposing all resources
+     */
+    ~ActionSlots() { dispose(); }
+
+    /**
+     * Stops every action and forgets every handle.
+     *
+     * The animated nodes keep whatever state they had when their actions
+     * stopped. A disposed manager can be used again.
+     */
+    void dispose() {
+        for (Handle handle : _running) {
+            Slot& slot = _slots[handle];
+            slot.action->stop(slot.target, &(slot.state));
+        }
+        _running.clear();
+        _slots.clear();
+    }
+
+    /**
+     * Returns a newly allocated action manager.
+     *
+     * @return a newly allocated action manager.
+     */
+    static std::shared_ptr<ActionSlots> alloc() {
+        return std::make_shared<ActionSlots>();
+    }
+
+#pragma mark Handles
+public:
+    /**
+     * Returns a new handle.
+     *
+     * Entities call this when they are created, once for every action they
+     * may run at the same time.
+     */
+    Handle reserve() {
+        Slot slot;
+        slot.state = nullptr;
+        slot.elapsed = 0;
+        slot.running = -1;
+        _slots.push_back(slot);
+        return (Handle)_slots.size() - 1;
+    }
+
+#pragma mark Action Management
+public:
+    /**
+     * Returns true if the given handle has an active animation
+     *
+     * @param handle    The handle of the animation
+     */
+    bool isActive(Handle handle) const {
+        return valid(handle) && _slots[handle].running >= 0;
+    }
+
+    /**
+     * Activates an animation with the given target and action
+     *
+     * This method will fail if the handle already has an animation.
+     *
+     * @param handle    The handle of the animation
+     * @param action    The action to animate with
+     * @param target    The node to animate on
+     * @param easing    The easing (interpolation) function, or nullptr
+     *
+     * @return true if the animation was successfully started
+     */
+    bool activate(Handle handle,
+                  const std::shared_ptr<scene2::Action>& action,
+                  const std::shared_ptr<scene2::SceneNode>& target,
+                  std::function<float(float)> easing = nullptr) {
+        if (!valid(handle) || _slots[handle].running >= 0) {
+            return false;
+        }
+        Slot& slot = _slots[handle];
+        slot.action = action;
+        slot.target = target;
+        slot.interpolant = easing;
+        slot.state = nullptr;
+        slot.elapsed = 0;
+        action->start(target, &(slot.state));
+        slot.running = (int)_running.size();
+        _running.push_back(handle);
+        return true;
+    }
+
+    /**
+     * Removes the animation of the given handle.
+     *
+     * This act will immediately stop the animation. The animated node will
+     * continue to have whatever state it had when the animation stopped.
+     *
+     * @param handle    The handle of the animation
+     *
+     * @return true if the animation was successfully removed
+     */
+    bool remove(Handle handle) {
+        if (!isActive(handle)) {
+            return false;
+        }
+        Slot& slot = _slots[handle];
+        slot.action->stop(slot.target, &(slot.state));
+        release(handle);
+        return true;
+    }
+
+    /**
+     * Updates all animations by dt seconds
+     *
+     * Each animation is moved forward by dt second. If this causes an
+     * animation to reach its duration, the animation is removed and the
+     * handle is free for the next one.
+     *
+     * @param dt    The number of seconds to animate
+     */
+    void update(float dt) {
+        int k = 0;
+        while (k < _running.size()) {
+            Handle handle = _running[k];
+            Slot& slot = _slots[handle];
+            scene2::Action* action = slot.action.get();
+            float current = 1.0f;
+            float future  = 1.0f;
+            if (action->getDuration() > 0) {
+                current = slot.elapsed / action->getDuration();
+                future  = (slot.elapsed + dt) / action->getDuration();
+                // Clamp to end
+                if (future > 1.0f) {
+                    future = 1.0f;
+                }
+            } else {
+                current = 0.0f;
+            }
+
+            if (slot.interpolant) {
+                current = slot.interpolant(current);
+                future  = slot.interpolant(future);
+            }
+
+            action->update(slot.target, slot.state, future - current);
+            slot.elapsed += dt;
+            if (slot.elapsed >= action->getDuration()) {
+                action->stop(slot.target, &(slot.state));
+                // the last running slot moves into position k
+                release(handle);
+            }
+            else {
+                k += 1;
+            }
+        }
+    }
+
+#pragma mark Helpers
+private:
+    bool valid(Handle handle) const {
+        return handle >= 0 && handle < _slots.size();
+    }
+
+    /** Marks a slot idle and drops it from the running list */
+    void release(Handle handle) {
+        Slot& slot = _slots[handle];
+        Handle last = _running.back();
+        _running[slot.running] = last;
+        _slots[last].running = slot.running;
+        _running.pop_back();
+        slot.running = -1;
+        slot.action = nullptr;
+        slot.target = nullptr;
+        slot.interpolant = nullptr;
+    }
+};
+
+#endif /* __ACTION_SLOTS_H__ */
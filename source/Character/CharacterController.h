@@ -128,6 +128,12 @@ public:
         return _model->containsNear(point);
     }
     
+    /** Returns the box around every point `containsFar` can reach, for broadphase queries */
+    Rect getReach(){
+        float r = _model->getRadius();
+        return Rect(_model->getPosition() - Vec2(r, r), Size(2 * r, 2 * r));
+    }
+    
 #pragma mark Scene Methods
 public:
     /**
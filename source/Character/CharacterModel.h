@@ -81,6 +81,10 @@ public:
     void setNumArt(int n){
         _n_art = n;
     }
+    
+    int getRadius(){
+        return radius;
+    }
 
 
     
@@ -0,0 +1,407 @@
+//
+//  AABBTree.h
+//  Tilemap
+//
+//  Dynamic bounding volume tree for overlap queries between entities.
+//
+
+#ifndef __AABB_TREE_H__
+#define __AABB_TREE_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <algorithm>
+
+using namespace cugl;
+
+/**
+ * A dynamic tree of axis-aligned boxes.
+ *
+ * Every entity owns a proxy: a leaf holding a box around the entity and an
+ * int of user data. The inner nodes hold the union of their children, so an
+ * overlap query only descends into subtrees whose box touches the query box.
+ *
+ * Leaves store their box grown by a margin. An entity that moves a little
+ * stays inside its leaf box, so `moveProxy` only has to take the leaf out
+ * and insert it again once the entity leaves it. Insertion picks the sibling
+ * that grows the tree's area the least, and rotations keep the tree
+ * balanced.
+ *
+ * Nodes live in one array and are linked by index, with a free list for
+ * removed ones, so proxies are plain ints that stay valid until destroyed.
+ */
+class AABBTree {
+
+#pragma mark Constants
+public:
+    /** Id of no node */
+    static constexpr int NULL_NODE = -1;
+
+#pragma mark Internal References
+private:
+    struct Node {
+        /** Bounds of the subtree; the grown box of a leaf */
+        float minX, minY, maxX, maxY;
+        /** Parent in the tree, or next free node while on the free list */
+        int parent;
+        int child1;
+        int child2;
+        /** 0 for leaves, -1 for free nodes */
+        int height;
+        int userData;
+
+        bool isLeaf() const {
+            return child1 == NULL_NODE;
+        }
+    };
+
+    std::vector<Node> _nodes;
+    int _root;
+    int _freeList;
+    int _proxyCount;
+    /** How much a leaf box is grown around its entity */
+    float _margin;
+    /** Reusable traversal stack for queries */
+    std::vector<int> _stack;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Creates an empty tree.
+     *
+     * @param margin    How far an entity may move before its leaf is reinserted
+     */
+    AABBTree(float margin = 0) {
+        _margin = margin;
+        clear();
+    }
+
+    /** Removes every proxy */
+    void clear() {
+        _nodes.clear();
+        _root = NULL_NODE;
+        _freeList = NULL_NODE;
+        _proxyCount = 0;
+    }
+
+    /**
+     * Adds an entity to the tree.
+     *
+     * @param bounds    The box around the entity
+     * @param userData  Data handed back by queries for this entity
+     *
+     * @return the proxy of the entity
+     */
+    int createProxy(const Rect& bounds, int userData) {
+        int leaf = allocateNode();
+        Node& node = _nodes[leaf];
+        node.minX = bounds.getMinX() - _margin;
+        node.minY = bounds.getMinY() - _margin;
+        node.maxX = bounds.getMaxX() + _margin;
+        node.maxY = bounds.getMaxY() + _margin;
+        node.height = 0;
+        node.userData = userData;
+        insertLeaf(leaf);
+        _proxyCount += 1;
+        return leaf;
+    }
+
+    /** Removes an entity from the tree */
+    void destroyProxy(int proxy) {
+        removeLeaf(proxy);
+        freeNode(proxy);
+        _proxyCount -= 1;
+    }
+
+    /**
+     * Moves an entity to a new box.
+     *
+     * @return true if the leaf had to be reinserted
+     */
+    bool moveProxy(int proxy, const Rect& bounds) {
+        Node& node = _nodes[proxy];
+        if (node.minX <= bounds.getMinX() && node.minY <= bounds.getMinY() &&
+            node.maxX >= bounds.getMaxX() && node.maxY >= bounds.getMaxY()) {
+            return false;
+        }
+        removeLeaf(proxy);
+        Node& moved = _nodes[proxy];
+        moved.minX = bounds.getMinX() - _margin;
+        moved.minY = bounds.getMinY() - _margin;
+        moved.maxX = bounds.getMaxX() + _margin;
+        moved.maxY = bounds.getMaxY() + _margin;
+        insertLeaf(proxy);
+        return true;
+    }
+
+    /** Returns the user data of a proxy */
+    int getUserData(int proxy) const {
+        return _nodes[proxy].userData;
+    }
+
+    /** Changes the user data of a proxy */
+    void setUserData(int proxy, int userData) {
+        _nodes[proxy].userData = userData;
+    }
+
+    /**
+     * Calls `callback` with the user data of every proxy whose box overlaps `bounds`.
+     *
+     * The leaf boxes are grown by the margin, so the callback still has to
+     * run the exact test. It returns false to stop the query early.
+     */
+    template <typename Callback>
+    void query(const Rect& bounds, Callback callback) {
+        if (_root == NULL_NODE) {
+            return;
+        }
+        float minX = bounds.getMinX(), minY = bounds.getMinY();
+        float maxX = bounds.getMaxX(), maxY = bounds.getMaxY();
+        _stack.clear();
+        _stack.push_back(_root);
+        while (!_stack.empty()) {
+            const Node& node = _nodes[_stack.back()];
+            _stack.pop_back();
+            if (node.maxX < minX || node.minX > maxX || node.maxY < minY || node.minY > maxY) {
+                continue;
+            }
+            if (node.isLeaf()) {
+                if (!callback(node.userData)) {
+                    return;
+                }
+            }
+            else {
+                _stack.push_back(node.child1);
+                _stack.push_back(node.child2);
+            }
+        }
+    }
+
+#pragma mark Statistics
+public:
+    /** Returns the number of proxies */
+    int size() const {
+        return _proxyCount;
+    }
+
+    /** Returns the height of the tree, 0 for a single leaf */
+    int height() const {
+        return _root == NULL_NODE ? 0 : _nodes[_root].height;
+    }
+
+#pragma mark Helpers
+private:
+    int allocateNode() {
+        int id;
+        if (_freeList != NULL_NODE) {
+            id = _freeList;
+            _freeList = _nodes[id].parent;
+        }
+        else {
+            id = (int)_nodes.size();
+            _nodes.emplace_back();
+        }
+        Node& node = _nodes[id];
+        node.parent = NULL_NODE;
+        node.child1 = NULL_NODE;
+        node.child2 = NULL_NODE;
+        node.height = 0;
+        node.userData = -1;
+        return id;
+    }
+
+    void freeNode(int id) {
+        _nodes[id].parent = _freeList;
+        _nodes[id].height = -1;
+        _freeList = id;
+    }
+
+    static float perimeter(float minX, float minY, float maxX, float maxY) {
+        return 2 * ((maxX - minX) + (maxY - minY));
+    }
+
+    static float perimeter(const Node& n) {
+        return perimeter(n.minX, n.minY, n.maxX, n.maxY);
+    }
+
+    /** Returns the perimeter of the union of two nodes' boxes */
+    static float unionPerimeter(const Node& a, const Node& b) {
+        return perimeter(std::min(a.minX, b.minX), std::min(a.minY, b.minY),
+                         std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY));
+    }
+
+    /** Sets the box and height of an inner node from its children */
+    void refit(int id) {
+        Node& node = _nodes[id];
+        const Node& a = _nodes[node.child1];
+        const Node& b = _nodes[node.child2];
+        node.minX = std::min(a.minX, b.minX);
+        node.minY = std::min(a.minY, b.minY);
+        node.maxX = std::max(a.maxX, b.maxX);
+        node.maxY = std::max(a.maxY, b.maxY);
+        node.height = 1 + std::max(a.height, b.height);
+    }
+
+    void insertLeaf(int leaf) {
+        if (_root == NULL_NODE) {
+            _root = leaf;
+            _nodes[leaf].parent = NULL_NODE;
+            return;
+        }
+
+        // walk down to the sibling that makes the tree grow the least
+        // (the perimeter stands in for the surface area in 2D)
+        int index = _root;
+        while (!_nodes[index].isLeaf()) {
+            const Node& node = _nodes[index];
+            const Node& leafNode = _nodes[leaf];
+            float area = perimeter(node);
+            float combined = unionPerimeter(node, leafNode);
+            // cost of making a new parent for this node and the leaf
+            float cost = 2 * combined;
+            // least cost of pushing the leaf further down
+            float inheritance = 2 * (combined - area);
+            float cost1 = descendCost(node.child1, leaf, inheritance);
+            float cost2 = descendCost(node.child2, leaf, inheritance);
+            if (cost < cost1 && cost < cost2) {
+                break;
+            }
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        // join the sibling and the leaf under a new parent
+        int sibling = index;
+        int oldParent = _nodes[sibling].parent;
+        int newParent = allocateNode();
+        _nodes[newParent].parent = oldParent;
+        _nodes[newParent].child1 = sibling;
+        _nodes[newParent].child2 = leaf;
+        _nodes[sibling].parent = newParent;
+        _nodes[leaf].parent = newParent;
+        refit(newParent);
+        if (oldParent != NULL_NODE) {
+            if (_nodes[oldParent].child1 == sibling) {
+                _nodes[oldParent].child1 = newParent;
+            }
+            else {
+                _nodes[oldParent].child2 = newParent;
+            }
+        }
+        else {
+            _root = newParent;
+        }
+
+        // fix the boxes and heights back up to the root
+        for (int i = _nodes[leaf].parent; i != NULL_NODE; i = _nodes[i].parent) {
+            i = balance(i);
+            refit(i);
+        }
+    }
+
+    /** Returns the cost of inserting `leaf` below `child` */
+    float descendCost(int child, int leaf, float inheritance) const {
+        const Node& c = _nodes[child];
+        float combined = unionPerimeter(c, _nodes[leaf]);
+        if (c.isLeaf()) {
+            return combined + inheritance;
+        }
+        return (combined - perimeter(c)) + inheritance;
+    }
+
+    void removeLeaf(int leaf) {
+        if (leaf == _root) {
+            _root = NULL_NODE;
+            return;
+        }
+        int parent = _nodes[leaf].parent;
+        int grandParent = _nodes[parent].parent;
+        int sibling = _nodes[parent].child1 == leaf ? _nodes[parent].child2 : _nodes[parent].child1;
+
+        // the sibling takes the place of the parent
+        if (grandParent != NULL_NODE) {
+            if (_nodes[grandParent].child1 == parent) {
+                _nodes[grandParent].child1 = sibling;
+            }
+            else {
+                _nodes[grandParent].child2 = sibling;
+            }
+            _nodes[sibling].parent = grandParent;
+            freeNode(parent);
+            for (int i = grandParent; i != NULL_NODE; i = _nodes[i].parent) {
+                i = balance(i);
+                refit(i);
+            }
+        }
+        else {
+            _root = sibling;
+            _nodes[sibling].parent = NULL_NODE;
+            freeNode(parent);
+        }
+    }
+
+    /**
+     * Rotates the subtree at `a` if one side is more than one level taller.
+     *
+     * @return the node now at the position of `a`
+     */
+    int balance(int a) {
+        Node& A = _nodes[a];
+        if (A.isLeaf() || A.height < 2) {
+            return a;
+        }
+        int b = A.child1;
+        int c = A.child2;
+        int diff = _nodes[c].height - _nodes[b].height;
+        if (diff > 1) {
+            return rotateUp(a, c);
+        }
+        if (diff < -1) {
+            return rotateUp(a, b);
+        }
+        return a;
+    }
+
+    /**
+     * Lifts the taller child `up` of `a` into its place.
+     *
+     * The shorter grandchild under `up` moves down to become a child of `a`.
+     */
+    int rotateUp(int a, int up) {
+        int f = _nodes[up].child1;
+        int g = _nodes[up].child2;
+
+        // `up` takes the place of `a`
+        _nodes[up].child1 = a;
+        _nodes[up].parent = _nodes[a].parent;
+        _nodes[a].parent = up;
+        int upParent = _nodes[up].parent;
+        if (upParent != NULL_NODE) {
+            if (_nodes[upParent].child1 == a) {
+                _nodes[upParent].child1 = up;
+            }
+            else {
+                _nodes[upParent].child2 = up;
+            }
+        }
+        else {
+            _root = up;
+        }
+
+        // the taller grandchild stays under `up`, the other one moves under `a`
+        int keep = _nodes[f].height > _nodes[g].height ? f : g;
+        int move = keep == f ? g : f;
+        _nodes[up].child2 = keep;
+        if (_nodes[a].child1 == up) {
+            _nodes[a].child1 = move;
+        }
+        else {
+            _nodes[a].child2 = move;
+        }
+        _nodes[move].parent = a;
+        refit(a);
+        refit(up);
+        return up;
+    }
+};
+
+#endif /* __AABB_TREE_H__ */
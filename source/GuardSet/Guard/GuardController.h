@@ -13,8 +13,11 @@
 // #define DURATION 1.0f
 
 /**
- * A class communicating between the model and the view. It only
- * controls a single tile.
+ * A class communicating between the model and the view of one guard.
+ *
+ * The guard set simulates every guard in its GuardCore. This class only
+ * keeps the scene nodes of a guard and copies the simulated state into them
+ * once per frame, in `sync`.
  */
 class GuardController {
     
@@ -26,50 +29,14 @@ private:
     std::unique_ptr<GuardView> _view;
     /**guards ID**/
     int _id;
-    /** patrol locations for the guard to follow*/
+    /** patrol locations for the guard to follow, centred on the node*/
     vector<Vec2> _patrol_stops;
-    //The current stop of the guard (index in _patrol_stops)
-    int _goingTo = 0;
     
     bool _doesPatrol;
     
-    std::shared_ptr<cugl::scene2::MoveTo> _patrolMove;
-    std::shared_ptr<cugl::scene2::MoveTo> _chaseMove;
-    std::shared_ptr<cugl::scene2::MoveTo> _returnMove;
-
-    /**vector for the guard to use to return to his post*/
-    vector<Vec2> _returnVec;
-
-    vector<Vec2> _chaseVec;
-    
-    //whether or not guard returned from chasing
-    bool returned;
-    //saved stop to use when returning
-    int saved_stop = 0;
-    //current state
-    string _state;
-    //prev state
-    string _prev_state;
-    // if the guard is in question state
-    bool _is_question;
     // fixed direction for static guard
     int _staticDir;
 
-    string _state_before_question;
-
-    bool _if_question_inSP;
-
-    Vec2 _static_pos;
-
-    // should be a value from 0 - 3000, because we use milliseconds
-    int _question_value;
-    
-    //patrol speed
-    int _patrol_speed;
-    
-    //chase speed
-    int _chase_speed;
-
     
 #pragma mark Main Methods
 public:
@@ -77,16 +44,6 @@ public:
     const int& id;
     /**view only version of ID**/
     const bool& doesPatrol;
-    /**view only version of return vec**/
-    const vector<Vec2>& returnVec;
-
-    const vector<Vec2>& chaseVec;
-
-    /**view only version of state**/
-    const string& state;
-
-    /**view only version of prev state**/
-    const string& prev_state;
     
     
     /**
@@ -97,63 +54,24 @@ public:
      * @param color     The tile color
      */
     //static guard
-    GuardController(Vec2 position, const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<cugl::scene2::ActionManager> actions, int id, bool isPast, int dir)
-    : id(_id), doesPatrol(_doesPatrol), returnVec(_returnVec), chaseVec(_chaseVec),state(_state), prev_state(_prev_state)
+    GuardController(Vec2 position, const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<ActionSlots> actions, int id, bool isPast, int dir)
+    : id(_id), doesPatrol(_doesPatrol)
     {
-        _state = "static";
-        _prev_state = "static";
-        _returnVec = {};
-        _chaseVec = {};
-        _chaseMove = cugl::scene2::MoveTo::alloc();
-        _chaseMove->setDuration(DURATION);
-        
-        _returnMove = cugl::scene2::MoveTo::alloc();
-        _returnMove->setDuration(DURATION);
-        _is_question = false;
-        _patrol_speed = 53;
-        _chase_speed = 120;
         _doesPatrol = false;
         _id = id;
-
         _staticDir = dir;
-        _if_question_inSP = false;
-
-        _question_value = 0;
 
         // dont move the relative position!!!
         _view = std::make_unique<GuardView>(position,Size(100, 100), Color4::RED, assets, actions, isPast);
         _model = std::make_unique<GuardModel>(_view->nodePos(), Size(100, 100), Color4::RED, _staticDir);
-        _static_pos = _view->nodePos();
         // dont move the relative position!!!
 
     }
     
     //moving guard
-    GuardController(Vec2 position, const std::shared_ptr<cugl::AssetManager>& assets, std::vector<Vec2> vec, std::shared_ptr<cugl::scene2::ActionManager> actions, int id, bool isPast) : id(_id), doesPatrol(_doesPatrol), returnVec(_returnVec), chaseVec(_chaseVec), state(_state), prev_state(_prev_state)
+    GuardController(Vec2 position, const std::shared_ptr<cugl::AssetManager>& assets, std::vector<Vec2> vec, std::shared_ptr<ActionSlots> actions, int id, bool isPast) : id(_id), doesPatrol(_doesPatrol)
     {
-        _state = "patrol";
-        _prev_state = "patrol";
-        _goingTo = 0;
-        _returnVec = {};
-        _chaseVec = {};
-        saved_stop = 1;
-        returned = false;
-        _chaseMove = cugl::scene2::MoveTo::alloc();
-        _chaseMove->setDuration(DURATION);
-        
-        _patrol_speed = 53;
-        _chase_speed = 120;
-        
-        _returnMove = cugl::scene2::MoveTo::alloc();
-        _returnMove->setDuration(DURATION);
-        
-        _patrolMove = cugl::scene2::MoveTo::alloc();
         _doesPatrol = true;
-        _is_question = false;
-        _if_question_inSP = false;
-
-
-        _question_value = 0;
 
         // just a placeholder for moving guard
         _staticDir = 0;
@@ -170,8 +88,6 @@ public:
         for(unsigned int i = 0; i < vecSize; i++) {
             _patrol_stops[i]  = _patrol_stops[i] + (_view->nodeSize() / 2);
         }
-        _static_pos = _view->nodePos();
-        CULog("initial pos: %f, %f", _view->nodePos().x, _view->nodePos().y);
         // dont move the relative position!!!
     }
 
@@ -189,57 +105,39 @@ public:
         _view->setPosition(position);
     }
 
-    Vec2 getStaticPosition() {
-        return _static_pos;
-    }
-
-    void setStaticPosition(Vec2 value) {
-        _static_pos = value;
-    }
-
-    void setStateBeforeQuestion(string s) {
-        _state_before_question = s;
-    }
-
-    string getStateBeforeQuestion() {
-        return _state_before_question;
-    }
-
-    bool getIfQuestionInSP(){
-        return _if_question_inSP;
-    }
-
-    void setIfQuestionInSP(bool value) {
-        _if_question_inSP = value;
-    }
+    /**
+     * Copies the simulated state of this guard into the model and the view.
+     *
+     * The animation only restarts when the direction or the state changed
+     * since the last frame.
+     *
+     * @param position      The centre of the guard
+     * @param direction     The way the guard faces now
+     * @param last_direction The way it faced in the last frame
+     * @param state         The state of the guard now
+     * @param last_state    Its state in the last frame
+     * @param question      The question value, shown while in question
+     */
+    void sync(Vec2 position, int direction, int last_direction, GuardState state, GuardState last_state, float question) {
+        updatePosition(position);
+        _view->performAnimation(direction, state, last_direction, last_state);
+        _model->setDirection(direction);
 
-#pragma mark Update Chase Methods
-    
-    void updateChaseTarget(Vec2 pos){
-        _chaseMove->setTarget(pos);
-    }
-    
-#pragma mark Update Patrol Methods
-    
-    void updatePatrolSpeed(float speed){
-        _patrolMove->setDuration(speed);
-    }
-    
-#pragma mark Update Return Methods
-    
-    void updateReturnSpeed(float speed){
-        _returnMove->setDuration(speed);
-    }
-    
-    void updateReturnTarget(Vec2 pos){
-        _returnMove->setTarget(pos);
-    }
+        if (state == GuardState::QUESTION) {
+            _view->startQuestionAnim(question);
+        }
+        else if (last_state == GuardState::QUESTION) {
+            _view->stopQuestionAnim();
+        }
 
-    void updateChaseSPTarget(Vec2 pos){
-        _chaseMove->setTarget(pos);
+        if (GuardStates::info(state).alarmed) {
+            _view->start_exclamation();
+        }
+        else {
+            _view->stop_exclamation();
+        }
     }
 
-
     /**
      *  Updates the model and view with the size of this tile.
      *
@@ -253,6 +151,14 @@ public:
     Vec2 getNodePosition(){
         return _view->nodePos();
     }
+
+    const vector<Vec2>& getPatrolStops() {
+        return _patrol_stops;
+    }
+
+    int getStaticDirection() {
+        return _staticDir;
+    }
     
 //#pragma mark Helpers
 //    /**
@@ -287,149 +193,9 @@ public:
 
 #pragma mark Controller Methods
 public:
-    //moves the guard to the next patrol stop
-    void nextStop(string actionName){
-        if (returned){
-            _goingTo = saved_stop;
-            returned = false;
-        }
-        else{
-            if (_goingTo + 1 == _patrol_stops.size()){
-                _goingTo = 0;
-            }
-            else{
-                _goingTo += 1;
-            }
-        }
-        
-        
-        float distance = getNodePosition().distance(_patrol_stops[_goingTo]);
-        float duration = distance / _patrol_speed;
-        
-        //move guard
-        _patrolMove->setDuration(duration);
-        _patrolMove->setTarget(_patrol_stops[_goingTo]);
-        _view->performAction(actionName, _patrolMove);
-        
-
-        //animate guard
-
-    }
-    
-    void drawPatrolPath(shared_ptr<cugl::Scene2> s){
+    void drawPatrolPath(shared_ptr<cugl::Scene2> s, Vec2 target){
         
-        _view->drawPatrolPath(s, getNodePosition(),_patrol_stops[_goingTo] );
-    }
-
-    void start_exclamation() {
-        // CULog("start exclamation");
-        _view->start_exclamation();
-    }
-
-    void stop_exclamation() {
-        // CULog("stop exclamation");
-        _view->stop_exclamation();
-    }
-
-    void updateAnimation(Vec2 target, string state, int last_direction, string last_state, bool valid_target, string id) {
-
-        int direction;
-        if (!valid_target and state == "static") {
-            direction = _staticDir;
-        }
-        else if (!valid_target and state == "question") {
-            direction = last_direction;
-        }
-        else {
-            Vec2 pos = _view->nodePos();
-            direction = calculateMappedAngle(pos.x, pos.y, target.x, target.y);
-        }
-        _view->performAnimation(direction, state, last_direction, last_state, id);
-        _model->setDirection(direction);
-
-
-    }
-
-    void stopQuestionAnim(string id){
-        _view->stopQuestionAnim(id);
-    }
-
-    void lookAroundAnim(string id) {
-        updateAnimation(Vec2(0,0), _state, _model->getDirection(), _prev_state, false, id);
-    }
-    void questionAnim(string id, float time) {
-        updateAnimation(Vec2(0,0), _state, _model->getDirection(), _prev_state, false,id);
-        // question animation
-        _view->startQuestionAnim(id, time);
-    }
-
-    void staticGuardAnim(string id) {
-        updateAnimation(Vec2(0,0), _state, _model->getDirection(), _prev_state, false, id);
-    }
-
-    void chaseGuardAnim(string id) {
-        updateAnimation(_chaseMove->getTarget(), _state, _model->getDirection(), _prev_state, true, id);
-    }
-
-    void patrolGuardAnim(string id) {
-        updateAnimation(_patrolMove->getTarget(), _state, _model->getDirection(), _prev_state, true, id);
-    }
-
-    void returnGuardAnim(string id) {
-        updateAnimation(_returnMove->getTarget(), _state, _model->getDirection(), _prev_state, true, id);
-    }
-
-    void chaseChar(string actionName){
-        // CULog("chasing");
-        //updateChaseSpeed(0.45);
-        float speed = _chase_speed;
-        float distance = getNodePosition().distance(_chaseMove->getTarget());
-        float duration = distance / speed;
-        //move guard
-        _chaseMove->setDuration(duration);
-        _view->performAction(actionName, _chaseMove);
-    }
-    
-    void returnGuard(string actionName){
-        // CULog("returning");
-        float speed = 53;
-        float distance = getNodePosition().distance(_returnMove->getTarget());
-        float duration = distance / speed;
-        //move guard
-        _returnMove->setDuration(duration);
-        _view->performAction(actionName, _returnMove);
-    }
-    
-    void prependReturnVec(Vec2 pos){
-        _returnVec.insert(_returnVec.begin(), pos);
-    }
-    
-    void setReturnVec(vector<Vec2> returnVec){
-        _returnVec = returnVec;
-    }
-
-    void setChaseVec(vector<Vec2> chaseVec){
-        _chaseVec = chaseVec;
-    }
-
-    void eraseChaseSPVec(){
-        _chaseVec.erase(_chaseVec.begin());
-    }
-    void eraseReturnVec(){
-        _returnVec.erase(_returnVec.begin());
-    }
-    
-    void saveCurrentStop(){
-        saved_stop = _goingTo;
-        returned = true;
-    }
-
-    void setQuestionValue(int v) {
-        _question_value =v;
-    }
-
-    int getQuestionValue() {
-        return _question_value;
+        _view->drawPatrolPath(s, getNodePosition(), target);
     }
 
     int getDirection() {
@@ -441,82 +207,6 @@ public:
         _view->setVisibility(visible);
     }
     
-    void updateState(string state){
-        _state = state;
-    }
-    
-    void updatePrevState(string prev_state){
-        _prev_state = prev_state;
-    }
-    
-    Vec2 getSavedStop(){
-        return _patrol_stops[saved_stop];
-    }
-    
-    void updateChaseSpeed(int s){
-        if (_chase_speed < 181){
-            _chase_speed += s;
-        }
-    }
-    
-    void setChaseSpeed(int s){
-        _chase_speed = s;
-    }
-
-
-//    int getIsQuestion() {
-//        return _is_question;
-//    }
-//
-//    void setIsQuestion(bool value) {
-//        _is_question = value;
-//    }
-
-
-
-    int calculateMappedAngle(float x1, float y1, float x2, float y2)
-    {
-        // calculate the angle in radians
-        double angleRadians = atan2(y2 - y1, x2 - x1);
-
-        // convert the angle to degrees
-        float angleDegrees = angleRadians * 180.0 / M_PI;
-
-        // make sure the angle is between 0 and 360 degrees
-        if (angleDegrees < 0.0)
-        {
-            angleDegrees += 360.0;
-        }
-
-        // map the angle from 0 to 360 degrees to 0 to 7
-        //CULog("%f", angleDegrees);
-        if (angleDegrees > 337.5 || angleDegrees < 22.5) {
-            return 2;
-        } else if (angleDegrees >= 22.5 && angleDegrees < 67.5){
-            return 1;
-        }
-        else if (angleDegrees >= 67.5 && angleDegrees < 112.5){
-            return 0;
-        }
-        else if (angleDegrees >= 112.5 && angleDegrees < 157.5){
-            return 7;
-        }
-        else if (angleDegrees >= 157.5 && angleDegrees < 202.5){
-            return 6;
-        }
-        else if (angleDegrees >= 202.5 && angleDegrees < 247.5){
-            return 5;
-        }
-        else if (angleDegrees >= 247.5 && angleDegrees < 292.5){
-            return 4;
-        }else if (angleDegrees >= 292.5 && angleDegrees < 337.5){
-            return 3;
-        }
-
-        return 0;
-    }
-
-    
     void updatePriority(){
         _view->updatePriority();
     }
@@ -0,0 +1,101 @@
+//
+//  GuardState.h
+//  Tilemap
+//
+//  The states of the guard state machine and what each of them does.
+//
+
+#ifndef __GUARD_STATE_H__
+#define __GUARD_STATE_H__
+
+#include <cstdint>
+
+/** The state of a guard, one byte per guard */
+enum class GuardState : uint8_t {
+    /** Stands at its post */
+    STATIC,
+    /** Noticed something and stands still until it is sure */
+    QUESTION,
+    /** Runs straight at the character it sees */
+    CHASE_D,
+    /** Runs the shortest path to where it heard the character */
+    CHASE_SP,
+    /** Lost the character and looks around */
+    LOOKAROUND,
+    /** Walks between its patrol stops */
+    PATROL,
+    /** Walks back to its post or patrol stop */
+    RETURN
+};
+
+/**
+ * The static table of the guard state machine.
+ *
+ * Every state has one row saying how a guard behaves in it, which states it
+ * may change to, and which frames of the sprite sheet it plays. The guard
+ * set looks up the row instead of comparing states one by one, and checks
+ * every change of state against it.
+ */
+class GuardStates {
+
+#pragma mark Constants
+public:
+    /** Number of states */
+    static constexpr int COUNT = 7;
+
+    /** One row of the table */
+    struct Info {
+        /** Name of the state, for the log */
+        const char* name;
+        /** The guard stands still; its moves are stopped every update */
+        bool halts;
+        /** The guard shows the exclamation mark */
+        bool alarmed;
+        /** The states the guard may change to, one bit per state */
+        unsigned int next;
+        /** First frame of the animation in the sprite sheet */
+        int animStart;
+        /** Length of one animation cycle in seconds */
+        float animDuration;
+        /** The animation keeps the last direction instead of facing the target */
+        bool keepsDirection;
+    };
+
+#pragma mark Queries
+public:
+    /** Returns the row of the given state */
+    static const Info& info(GuardState state) {
+        static const Info table[COUNT] = {
+            // name         halts  alarmed  next                                                        anim  time  keeps
+            { "static",     true,  false,   bit(GuardState::QUESTION),                                  192,  1.0f, true  },
+            { "question",   true,  false,   bit(GuardState::STATIC) | bit(GuardState::CHASE_D) | bit(GuardState::CHASE_SP) |
+                                            bit(GuardState::LOOKAROUND) | bit(GuardState::PATROL) | bit(GuardState::RETURN),
+                                                                                                        192,  1.0f, true  },
+            { "chaseD",     false, true,    bit(GuardState::LOOKAROUND),                                64,   0.5f, false },
+            { "chaseSP",    false, true,    bit(GuardState::CHASE_D) | bit(GuardState::LOOKAROUND),     64,   0.5f, false },
+            { "lookaround", true,  false,   bit(GuardState::QUESTION) | bit(GuardState::RETURN),        128,  1.0f, true  },
+            { "patrol",     false, false,   bit(GuardState::QUESTION),                                  0,    1.0f, false },
+            { "return",     false, false,   bit(GuardState::QUESTION) | bit(GuardState::PATROL) | bit(GuardState::STATIC),
+                                                                                                        0,    1.0f, false },
+        };
+        return table[(int)state];
+    }
+
+    /** Returns the name of the given state */
+    static const char* name(GuardState state) {
+        return info(state).name;
+    }
+
+    /** Returns true if a guard may change from one state to the other */
+    static bool canChange(GuardState from, GuardState to) {
+        return (info(from).next & bit(to)) != 0;
+    }
+
+#pragma mark Helpers
+private:
+    static constexpr unsigned int bit(GuardState state) {
+        return 1u << (int)state;
+    }
+};
+
+#endif /* __GUARD_STATE_H__ */
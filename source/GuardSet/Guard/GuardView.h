@@ -9,6 +9,8 @@
 #define GuardView_h
 
 #include <cugl/cugl.h>
+#include "GuardState.h"
+#include <Action/ActionSlots.h>
 using namespace cugl;
 
 #include <math.h>
@@ -27,7 +29,9 @@ private:
 
 
     /** Manager to process the animation actions */
-    std::shared_ptr<cugl::scene2::ActionManager> _actions;
+    std::shared_ptr<ActionSlots> _actions;
+    /** Handle of the walk, run or stand animation */
+    ActionSlots::Handle _animation;
 
     // questions mark
     std::shared_ptr<scene2::SpriteNode> _question_node;
@@ -46,9 +50,10 @@ private:
 #pragma mark Main Functions
 public:
     /** contructor */
-    GuardView(Vec2 position, Size size, Color4 color, const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<cugl::scene2::ActionManager> actions, bool isPast) {
+    GuardView(Vec2 position, Size size, Color4 color, const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<ActionSlots> actions, bool isPast) {
         // Get the image and add it to the node.
         _actions = actions;
+        _animation = _actions->reserve();
         float scale = GAME_WIDTH/size.width;
         // size *= scale;
         string a;
@@ -159,12 +164,7 @@ public:
         return _node->getSize();
     }
     
-    void performAction(string actionName, const std::shared_ptr<cugl::scene2::MoveTo>& action){
-        _actions->activate(actionName, action, _node);
-        _question_node->setVisible(false);
-    }
-
-    void stopQuestionAnim(string id){
+    void stopQuestionAnim(){
         // _actions->remove("question"+id);
         _question_node->setVisible(false);
     }
@@ -187,9 +187,9 @@ public:
 //        }
 //    }
 //
-    void startQuestionAnim(string id, float time){
+    void startQuestionAnim(float time){
         _question_node->setVisible(true);
-        // CULog("%s  %f", id.c_str(), time);
+        // CULog("%f", time);
         int num_frame = (time * 8) / 3000;
         if (num_frame == 8) {
             num_frame = 7;
@@ -197,43 +197,25 @@ public:
         _question_node->setFrame(num_frame);
     }
 
-    void performAnimation(int current_d, string state, int last_direction, string last_state, string id) {
+    void performAnimation(int current_d, GuardState state, int last_direction, GuardState last_state) {
         //CULog("%d", d);
-        if (_actions->isActive("guard_animation"+id) and current_d == last_direction and state == last_state) {
+        if (_actions->isActive(_animation) and current_d == last_direction and state == last_state) {
             // continue the current animation
             return;
         }
 
-        if (_actions->isActive("guard_animation"+id) and (current_d != last_direction or state != last_state)) {
-            _actions->remove("guard_animation"+id);
-       //     CULog("remove current animation, start a new one curent d:%d last d: %d  current state: %s   last state: %s", current_d, last_direction, state.c_str(), last_state.c_str());
+        if (_actions->isActive(_animation) and (current_d != last_direction or state != last_state)) {
+            _actions->remove(_animation);
+       //     CULog("remove current animation, start a new one curent d:%d last d: %d  current state: %s   last state: %s", current_d, last_direction, GuardStates::name(state), GuardStates::name(last_state));
         }
 
-        int direction;
         // walk or run or lookaround or static. this is the starting index in spritesheet
-        int start_index;
-        float duration;
-
-        if (state == "chaseD" or state == "chaseSP") {
-            // running
-            start_index = 64;
-            direction = current_d;
-            duration = 0.5f;
-        } else if (state == "patrol" or state=="return") {
-            // walking
-            start_index = 0;
-            direction = current_d;
-            duration = 1.0f;
-        } else if (state == "lookaround") {
-            // look around, need to use the last direction as the direction
-            start_index =  128;
-            direction = last_direction;
-            duration = 1.0f;
-        } else if (state == "static" or state == "question") {
-            start_index = 192;
-            direction = last_direction;
-            duration = 1.0f;
-        }
+        const GuardStates::Info& info = GuardStates::info(state);
+        int start_index = info.animStart;
+        float duration = info.animDuration;
+        // look around and standing use the last direction as the direction
+        int direction = info.keepsDirection ? last_direction : current_d;
+
         // looping frames
         std::vector<int> frames;
         for(int ii = 1 + start_index + 8*direction; ii < 8 + start_index + 8*direction; ii++) {
@@ -246,7 +228,7 @@ public:
 //        for(int i=0; i < frames.size(); i++) {
 //            CULog( "%d",frames.at(i));
 //        }
-        _actions->activate("guard_animation"+id, animation, _node);
+        _actions->activate(_animation, animation, _node);
 
     }
     
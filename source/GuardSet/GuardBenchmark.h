@@ -0,0 +1,85 @@
+//
+//  GuardBenchmark.h
+//  Tilemap
+//
+//  Times the guard update of one world.
+//
+
+#ifndef __GUARD_BENCHMARK_H__
+#define __GUARD_BENCHMARK_H__
+
+#include "GuardSetController.h"
+#include <cmath>
+
+/**
+ * Measures how long `GuardSetController::patrol` takes.
+ *
+ * The benchmark runs the full update for a number of frames while the
+ * character walks a circle through the guards, so perception, raycasts,
+ * state changes and path requests are all part of the time. The guards are
+ * put back where they were afterwards.
+ */
+class GuardBenchmark {
+
+#pragma mark Constants
+public:
+    /** Length of a simulated frame in seconds */
+    static constexpr float FRAME = 1.0f / 60.0f;
+    /** Speed the character walks its circle at */
+    static constexpr float SPEED = 200;
+
+    /** What one run measured */
+    struct Result {
+        /** Number of guards simulated */
+        int guards;
+        /** Number of frames simulated */
+        int frames;
+        /** Average milliseconds per frame spent simulating the guards */
+        double simMillis;
+        /** Average milliseconds per frame spent updating the views */
+        double syncMillis;
+        /** Guard frames spent anywhere but on patrol or at the post */
+        int alerted;
+    };
+
+#pragma mark Main Methods
+public:
+    /**
+     * Runs the update of `guards` for `frames` frames.
+     *
+     * The world of the guards is active while the benchmark runs, since
+     * guards only notice the character in the active world.
+     *
+     * @param guards    The guards to update
+     * @param centre    The centre of the circle the character walks
+     * @param radius    The radius of that circle
+     * @param frames    The number of frames to simulate
+     */
+    static Result run(GuardSetController& guards, const Vec2& centre, float radius, int frames) {
+        GuardCore saved = guards._core;
+        bool active = guards._world->isActive();
+        guards._world->setActive(true);
+
+        Result result = {guards.size(), frames, 0, 0, 0};
+        for (int f = 0; f < frames; f++) {
+            float angle = f * FRAME * SPEED / std::max(radius, 1.0f);
+            Vec2 character = centre + Vec2(std::cos(angle), std::sin(angle)) * radius;
+            guards.patrol(character, 0, nullptr, FRAME);
+            result.simMillis += guards.getSimMillis();
+            result.syncMillis += guards.getSyncMillis();
+            for (GuardState state : guards._core.state) {
+                result.alerted += state != GuardState::PATROL && state != GuardState::STATIC;
+            }
+        }
+        if (frames > 0) {
+            result.simMillis /= frames;
+            result.syncMillis /= frames;
+        }
+
+        guards._world->setActive(active);
+        guards.restoreCore(saved);
+        return result;
+    }
+};
+
+#endif /* __GUARD_BENCHMARK_H__ */
@@ -0,0 +1,348 @@
+//
+//  GuardCore.h
+//  Tilemap
+//
+//  The simulation state of every guard of a world, in flat arrays.
+//
+
+#ifndef __GUARD_CORE_H__
+#define __GUARD_CORE_H__
+
+#include <cugl/cugl.h>
+#include "Guard/GuardState.h"
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+using namespace cugl;
+
+/**
+ * The state of all guards of one world, one array per field.
+ *
+ * Guard `i` is entry `i` of every array. Perception, timers, moves and the
+ * state machine only walk these arrays, so an update over a thousand guards
+ * reads a few contiguous buffers instead of a thousand objects and their
+ * scene nodes. The views copy from the arrays once per frame, after the
+ * update.
+ *
+ * A move is a straight line at constant speed, like the MoveTo actions it
+ * replaces, and ends when the guard reaches its target. The chase and
+ * return paths vary in length and only change when a guard plans, so they
+ * stay one vector per guard.
+ */
+class GuardCore {
+
+#pragma mark Constants
+public:
+    /** The move a guard is making */
+    enum class Move : uint8_t {
+        NONE,
+        PATROL,
+        CHASE_D,
+        CHASE_SP,
+        RETURN
+    };
+
+    /** What a guard noticed of the character, see `perceive` */
+    enum Sense : uint8_t {
+        /** The character is in range and in the vision cone; line of sight is still to test */
+        MAY_SEE = 1,
+        /** The character is close enough to hear */
+        HEARS = 2
+    };
+
+    /** Speed of patrolling and returning guards */
+    static constexpr float WALK_SPEED = 53;
+    /** Speed a chase starts at */
+    static constexpr float CHASE_SPEED = 120;
+    /** A chase stops speeding up once it is this fast */
+    static constexpr float MAX_CHASE_SPEED = 181;
+
+#pragma mark Guard Data
+public:
+    /** Position of the centre of each guard */
+    std::vector<float> x;
+    std::vector<float> y;
+    /** Facing of each guard, 0 to 7, and its facing in the last frame */
+    std::vector<uint8_t> dir;
+    std::vector<uint8_t> prevDir;
+
+    /** State of each guard, its state at the start of this update, and its state before a question */
+    std::vector<GuardState> state;
+    std::vector<GuardState> prevState;
+    std::vector<GuardState> beforeQuestion;
+    /** Question value in milliseconds, from 0 to 3000 */
+    std::vector<float> question;
+    /** Seconds since the guard started looking around */
+    std::vector<float> lookaround;
+    /** Seconds since a guard in chaseSP started hearing the character */
+    std::vector<float> heard;
+    /** Whether a guard in chaseSP hears the character */
+    std::vector<uint8_t> hearing;
+
+    /** Move of each guard, its target and its speed */
+    std::vector<Move> move;
+    std::vector<float> targetX;
+    std::vector<float> targetY;
+    std::vector<float> speed;
+    /** Speed of the next chase move */
+    std::vector<float> chaseSpeed;
+
+    /** Whether the guard patrols, and otherwise its post and the way it faces there */
+    std::vector<uint8_t> patrols;
+    std::vector<float> postX;
+    std::vector<float> postY;
+    std::vector<uint8_t> postDir;
+    /** First patrol stop of each guard in stopX and stopY, and how many it has */
+    std::vector<int> stopFirst;
+    std::vector<int> stopCount;
+    std::vector<float> stopX;
+    std::vector<float> stopY;
+    /** The stop each guard walks to, and the one it goes back to after a chase */
+    std::vector<int> goingTo;
+    std::vector<int> savedStop;
+    std::vector<uint8_t> returned;
+
+    /** Ticket of the return path being searched, 0 if none */
+    std::vector<unsigned int> ticket;
+    /** The waypoints left of each chase and return path */
+    std::vector<std::vector<Vec2>> chaseRoute;
+    std::vector<std::vector<Vec2>> returnRoute;
+
+#pragma mark Main Methods
+public:
+    /** Returns the number of guards */
+    int size() const {
+        return (int)x.size();
+    }
+
+    /** Removes every guard */
+    void clear() {
+        *this = GuardCore();
+    }
+
+    /**
+     * Adds a guard that stands at its post.
+     *
+     * @param pos   The centre of the guard
+     * @param facing The way it faces, 0 to 7
+     *
+     * @return the index of the guard
+     */
+    int addStatic(const Vec2& pos, int facing) {
+        int i = add(pos, GuardState::STATIC, facing);
+        stopFirst.push_back((int)stopX.size());
+        stopCount.push_back(0);
+        return i;
+    }
+
+    /**
+     * Adds a guard that walks between patrol stops.
+     *
+     * @param pos   The centre of the guard
+     * @param stops The centres of its stops, at least one
+     *
+     * @return the index of the guard
+     */
+    int addPatrol(const Vec2& pos, const std::vector<Vec2>& stops) {
+        int i = add(pos, GuardState::PATROL, 0);
+        patrols[i] = true;
+        savedStop[i] = 1;
+        stopFirst.push_back((int)stopX.size());
+        stopCount.push_back((int)stops.size());
+        for (const Vec2& stop : stops) {
+            stopX.push_back(stop.x);
+            stopY.push_back(stop.y);
+        }
+        return i;
+    }
+
+    Vec2 position(int i) const {
+        return Vec2(x[i], y[i]);
+    }
+
+#pragma mark Timers and Moves
+public:
+    /** Advances the timers of every guard by dt seconds */
+    void tick(float dt) {
+        int n = size();
+        for (int i = 0; i < n; i++) {
+            lookaround[i] += dt;
+            heard[i] += dt;
+        }
+    }
+
+    /** Moves every guard that is making a move by dt seconds */
+    void step(float dt) {
+        int n = size();
+        for (int i = 0; i < n; i++) {
+            if (move[i] == Move::NONE) {
+                continue;
+            }
+            float dx = targetX[i] - x[i];
+            float dy = targetY[i] - y[i];
+            float distance = std::sqrt(dx * dx + dy * dy);
+            float length = speed[i] * dt;
+            if (length >= distance) {
+                x[i] = targetX[i];
+                y[i] = targetY[i];
+                move[i] = Move::NONE;
+            }
+            else {
+                x[i] += dx * (length / distance);
+                y[i] += dy * (length / distance);
+            }
+        }
+    }
+
+    /** Starts a move of guard `i`; the guard turns towards the target */
+    void startMove(int i, Move kind, const Vec2& target, float moveSpeed) {
+        move[i] = kind;
+        targetX[i] = target.x;
+        targetY[i] = target.y;
+        speed[i] = moveSpeed;
+    }
+
+    /** Returns true if guard `i` is making the given move */
+    bool isMoving(int i, Move kind) const {
+        return move[i] == kind;
+    }
+
+    /** Speeds up the next chase of guard `i` */
+    void speedUpChase(int i, float amount) {
+        if (chaseSpeed[i] < MAX_CHASE_SPEED) {
+            chaseSpeed[i] += amount;
+        }
+    }
+
+    /** Sends a patrolling guard to its next stop, or back to the saved one */
+    void nextStop(int i) {
+        if (returned[i]) {
+            goingTo[i] = savedStop[i];
+            returned[i] = false;
+        }
+        else {
+            goingTo[i] = goingTo[i] + 1 == stopCount[i] ? 0 : goingTo[i] + 1;
+        }
+        startMove(i, Move::PATROL, stop(i, goingTo[i]), WALK_SPEED);
+    }
+
+    /** Remembers the stop a patrolling guard was walking to */
+    void saveStop(int i) {
+        savedStop[i] = goingTo[i];
+        returned[i] = true;
+    }
+
+    /** Returns where guard `i` goes back to after a chase */
+    Vec2 home(int i) const {
+        return patrols[i] ? stop(i, savedStop[i]) : Vec2(postX[i], postY[i]);
+    }
+
+    Vec2 stop(int i, int k) const {
+        return Vec2(stopX[stopFirst[i] + k], stopY[stopFirst[i] + k]);
+    }
+
+#pragma mark Perception
+public:
+    /**
+     * Finds what every guard may notice of the character.
+     *
+     * Writes a combination of `Sense` flags per guard into `senses`. Only
+     * guards in vision range compute the direction to the character, and
+     * line of sight is left to the caller for the few that get MAY_SEE.
+     *
+     * @param charPos       The position of the character
+     * @param visionRange   How far a guard can see
+     * @param hearingRange  How far a guard can hear
+     * @param senses        Receives the flags, one per guard
+     */
+    void perceive(const Vec2& charPos, float visionRange, float hearingRange, std::vector<uint8_t>& senses) const {
+        int n = size();
+        senses.assign(n, 0);
+        float vision2 = visionRange * visionRange;
+        float hearing2 = hearingRange * hearingRange;
+        for (int i = 0; i < n; i++) {
+            float dx = charPos.x - x[i];
+            float dy = charPos.y - y[i];
+            float d2 = dx * dx + dy * dy;
+            uint8_t sense = d2 < hearing2 ? HEARS : 0;
+            if (d2 < vision2) {
+                // the cone spans two directions to either side of the facing
+                int offset = (sector(dx, dy) - dir[i] + 8) % 8;
+                if (offset <= 2 || offset >= 6) {
+                    sense |= MAY_SEE;
+                }
+            }
+            senses[i] = sense;
+        }
+    }
+
+    /**
+     * Returns the way guard `i` faces after this update.
+     *
+     * A guard on its post faces the way of the post, a guard that stands
+     * still or has reached its target keeps its facing, and any other guard
+     * faces its move target.
+     */
+    int facing(int i) const {
+        if (state[i] == GuardState::STATIC) {
+            return postDir[i];
+        }
+        float dx = targetX[i] - x[i];
+        float dy = targetY[i] - y[i];
+        if (GuardStates::info(state[i]).halts || (dx == 0 && dy == 0)) {
+            return dir[i];
+        }
+        return sector(dx, dy);
+    }
+
+    /**
+     * Returns the direction of a vector as one of 8 sectors.
+     *
+     * The sectors are numbered like the rows of the guard sprite sheet: 0 is
+     * up, 2 is right, 4 is down and 6 is left.
+     */
+    static int sector(float dx, float dy) {
+        float degrees = std::atan2(dy, dx) * 180.0f / M_PI;
+        if (degrees < 0) {
+            degrees += 360;
+        }
+        // 45 degree sectors centred on the axes, counted counter-clockwise from right
+        int k = (int)((degrees + 22.5f) / 45.0f) % 8;
+        return (10 - k) % 8;
+    }
+
+#pragma mark Helpers
+private:
+    int add(const Vec2& pos, GuardState start, int facing) {
+        x.push_back(pos.x);
+        y.push_back(pos.y);
+        dir.push_back(facing);
+        prevDir.push_back(facing);
+        state.push_back(start);
+        prevState.push_back(start);
+        beforeQuestion.push_back(start);
+        question.push_back(0);
+        lookaround.push_back(0);
+        heard.push_back(0);
+        hearing.push_back(false);
+        move.push_back(Move::NONE);
+        targetX.push_back(pos.x);
+        targetY.push_back(pos.y);
+        speed.push_back(0);
+        chaseSpeed.push_back(CHASE_SPEED);
+        patrols.push_back(false);
+        postX.push_back(pos.x);
+        postY.push_back(pos.y);
+        postDir.push_back(facing);
+        goingTo.push_back(0);
+        savedStop.push_back(0);
+        returned.push_back(false);
+        ticket.push_back(0);
+        chaseRoute.emplace_back();
+        returnRoute.emplace_back();
+        return size() - 1;
+    }
+};
+
+#endif /* __GUARD_CORE_H__ */
@@ -9,8 +9,20 @@
 #include "Guard/GuardModel.h"
 #include "Guard/GuardView.h"
 #include "Guard/GuardController.h"
+#include "GuardCore.h"
 #include <Tilemap/TilemapController.h>
 #include <ItemSet/ItemSetController.h>
+#include <Nav/NavGraph.h>
+#include <Nav/FlowField.h>
+#include <Nav/DStarLite.h>
+#include <Nav/NavQuery.h>
+#include <Nav/PathSmoother.h>
+#include <Nav/PathService.h>
+#include <Nav/NavMesh.h>
+#include <Nav/NavVisibility.h>
+#include <Collision/AABBTree.h>
+#include <unordered_map>
+#include <chrono>
 
 
 using namespace std;
@@ -24,6 +36,19 @@ using namespace std;
  */
 class GuardSetController {
     
+#pragma mark Constants
+public:
+    /** How far a guard can see the character */
+    static constexpr float VISION_RANGE = 300;
+    /** How far a guard can hear the character */
+    static constexpr float HEARING_RANGE = 150;
+    /** How far a guard moves before its proxy is reinserted in the guard tree */
+    static constexpr float TREE_MARGIN = 32;
+    /** Seconds a guard looks around before it returns */
+    static constexpr float LOOKAROUND_TIME = 3;
+    /** Seconds a guard in chaseSP hears the character before it plans its path again */
+    static constexpr float REPLAN_TIME = 3;
+
 #pragma mark External References
 public:
     /** Tilemape is a 2D vector list of tiles */
@@ -34,7 +59,7 @@ public:
     typedef std::shared_ptr<cugl::Scene2> _scene;
     
     /** Manager to process the animation actions */
-    std::shared_ptr<cugl::scene2::ActionManager> _actions;
+    std::shared_ptr<ActionSlots> _actions;
     
     /**vector of guard IDs**/
     vector<int> _usedIDs;
@@ -43,11 +68,71 @@ public:
     
     std::shared_ptr<ItemSetController> _items;
     
-    /**adjacency matrix*/
-    bool** _adjMatrix;
+    /** navigation graph of this world, shared with the level */
+    std::shared_ptr<NavGraph> _graph;
+    
+    /** reusable buffer for the node ids of the last path */
+    vector<int> _nodePath;
+    
+    /** flow field towards the player's node, shared by every guard that starts a chase */
+    FlowField _chaseField;
+    
+    /** incremental chase searches, one per guard in _guardSet */
+    vector<DStarLite> _chasePlanners;
+    
+    /** nearest node lookup on the navigation graph */
+    std::unique_ptr<NavQuery> _navQuery;
+    
+    /** path searches, on worker threads or on the main thread */
+    std::shared_ptr<PathService> _paths;
+    
+    /** the most path results integrated per update */
+    int _pathBudget;
+    
+    /** reusable buffer for the path results of this update */
+    vector<PathService::Result> _pathResults;
+    
+    /** a return path that is being searched */
+    struct PendingReturn {
+        /** index of the guard in _guardSet */
+        int guard;
+        /** exact point the guard returns to */
+        Vec2 target;
+    };
+    
+    /** return paths being searched, by ticket */
+    std::unordered_map<PathService::Ticket, PendingReturn> _pendingReturns;
+    
+    /** nav mesh of this world, nullptr if the guards path on the lattice */
+    std::shared_ptr<NavMesh> _navMesh;
+    
+    /** reusable buffer for nav mesh paths */
+    vector<Vec2> _meshPath;
+    
+    /** line of sight between the nodes of _graph, nullptr to always raycast */
+    std::shared_ptr<NavVisibility> _visibility;
     
-    /** nodes to vec2 positions*/
-    std::unordered_map<int, Vec2> _nodes;
+    /** broadphase over the guard positions */
+    AABBTree _guardTree;
+    
+    /** proxy of every guard in _guardTree, by index in _guardSet */
+    vector<int> _guardProxies;
+    
+    /** simulation state of every guard, by index in _guardSet */
+    GuardCore _core;
+    
+    /** reusable buffer for what each guard noticed of the character this update */
+    vector<uint8_t> _senses;
+    
+    /** frames between two timing reports in the log, 0 for none */
+    int _reportInterval;
+    /** frames, simulation and view milliseconds since the last report */
+    int _reportFrames;
+    double _simMillis;
+    double _syncMillis;
+    /** simulation and view milliseconds of the last update */
+    double _lastSimMillis;
+    double _lastSyncMillis;
     
     
 
@@ -56,18 +141,104 @@ public:
 #pragma mark Main Methods
 public:
     
-    GuardSetController(const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<cugl::scene2::ActionManager> actions, std::shared_ptr<TilemapController> world, std::shared_ptr<ItemSetController> items,
-        bool** adjMatrix, std::unordered_map<int, Vec2> nodes)
+    GuardSetController(const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<ActionSlots> actions, std::shared_ptr<TilemapController> world, std::shared_ptr<ItemSetController> items,
+        std::shared_ptr<NavGraph> graph, std::shared_ptr<PathService> paths)
     {
-        _adjMatrix = adjMatrix;
-        _nodes = nodes;
+        _graph = graph;
+        _paths = paths;
+        _pathBudget = PathService::DEFAULT_BUDGET;
+        _navQuery = std::make_unique<NavQuery>(graph);
         _world = world;
         _items = items;
         _actions = actions;
+        _guardTree = AABBTree(TREE_MARGIN);
+        _reportInterval = 0;
+        _reportFrames = 0;
+        _simMillis = 0;
+        _syncMillis = 0;
+        _lastSimMillis = 0;
+        _lastSyncMillis = 0;
         std::vector<Guard> _guardSet;
 
     };
     
+    ~GuardSetController() {
+        // the service outlives this controller when the level restarts
+        _paths->cancelAll();
+    }
+    
+    /**
+     * Makes the guards path on the given nav mesh instead of the lattice.
+     *
+     * @param mesh  The nav mesh of this world, or nullptr for the lattice
+     */
+    void setNavMesh(std::shared_ptr<NavMesh> mesh) {
+        _navMesh = mesh;
+    }
+    
+    /**
+     * Answers line of sight between nav nodes from the given matrix.
+     *
+     * @param visibility    The matrix of _graph, or nullptr to always raycast
+     */
+    void setNodeVisibility(std::shared_ptr<NavVisibility> visibility) {
+        _visibility = visibility;
+    }
+    
+    /** Sets the most path results integrated per update */
+    void setPathBudget(int budget) {
+        _pathBudget = budget;
+    }
+    
+    /**
+     * Logs the average time of the guard update every `frames` frames.
+     *
+     * The simulation of the guards and the update of their views are timed
+     * apart. 0 stops the reports.
+     */
+    void setReportInterval(int frames) {
+        _reportInterval = frames;
+        _reportFrames = 0;
+        _simMillis = 0;
+        _syncMillis = 0;
+    }
+    
+    /** Returns the number of guards */
+    int size() const {
+        return _core.size();
+    }
+    
+    /** Returns the centre of guard `i` */
+    Vec2 getPosition(int i) const {
+        return _core.position(i);
+    }
+    
+    /** Returns the milliseconds the last update spent simulating the guards */
+    double getSimMillis() const {
+        return _lastSimMillis;
+    }
+    
+    /** Returns the milliseconds the last update spent updating the views */
+    double getSyncMillis() const {
+        return _lastSyncMillis;
+    }
+    
+    /**
+     * Puts every guard back into a state saved from _core.
+     *
+     * The searches still running are dropped, so no guard waits for a
+     * return path. The views follow at once.
+     */
+    void restoreCore(const GuardCore& core) {
+        _core = core;
+        _paths->cancelAll();
+        _pendingReturns.clear();
+        std::fill(_core.ticket.begin(), _core.ticket.end(), PathService::NO_TICKET);
+        _chasePlanners.clear();
+        updateGuardTree();
+        syncViews();
+    }
+    
 #pragma mark Update Methods
 public:
 
@@ -75,12 +246,18 @@ public:
     void add_this_moving(Vec2 gPos, std::shared_ptr<cugl::scene2::OrderedNode> s, const std::shared_ptr<cugl::AssetManager>& assets, vector<Vec2> patrol_stops, bool isPast){
         Guard _guard = std::make_unique<GuardController>(gPos, assets, patrol_stops, _actions, generateUniqueID(), isPast);
         _guard->addChildTo(s);
+        Vec2 pos = _guard->getNodePosition();
+        _core.addPatrol(pos, _guard->getPatrolStops());
+        _guardProxies.push_back(_guardTree.createProxy(Rect(pos, Size::ZERO), (int)_guardSet.size()));
         _guardSet.push_back(std::move(_guard));
     }
     
     void add_this(Vec2 gPos, std::shared_ptr<cugl::scene2::OrderedNode> s, const std::shared_ptr<cugl::AssetManager>& assets, bool isPast, int dir){
         Guard _guard = std::make_unique<GuardController>(gPos, assets, _actions, generateUniqueID(), isPast, dir);
         _guard->addChildTo(s);
+        Vec2 pos = _guard->getNodePosition();
+        _core.addStatic(pos, dir);
+        _guardProxies.push_back(_guardTree.createProxy(Rect(pos, Size::ZERO), (int)_guardSet.size()));
         _guardSet.push_back(std::move(_guard));
     }
     
@@ -108,6 +285,12 @@ public:
     
     void clearSet () {
         _guardSet.clear();
+        _core.clear();
+        _paths->cancelAll();
+        _pendingReturns.clear();
+        _chasePlanners.clear();
+        _guardTree.clear();
+        _guardProxies.clear();
     }
     
 
@@ -128,607 +311,557 @@ public:
         return id;
     }
     
-    void patrol(Vec2 _charPos, float char_angle, shared_ptr<cugl::Scene2> scene, string world){
-
-       // static auto last_time_question = std::chrono::steady_clock::now();
-        static auto last_time_lookaround = std::chrono::steady_clock::now();
-        static auto start_question_inSP = std::chrono::steady_clock::now();
-        static auto last_time_question_value = std::chrono::steady_clock::now();
-        // Calculate the time elapsed since the last call to pinch
-        auto now = std::chrono::steady_clock::now();
-        // auto elapsed_question = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_time_question);
-        auto elapsed_lookaround = std::chrono::duration_cast<std::chrono::seconds>(now - last_time_lookaround);
-        auto elapsed_question_inSP = std::chrono::duration_cast<std::chrono::seconds>(now - start_question_inSP);
-        auto elapsed_question_value = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_time_question_value);
-
-        for (int i = 0; i < _guardSet.size(); i++){
-
-            string id = std::to_string(_guardSet[i]->id);
-
-            string chaseDAction = "chaseD" + id + world;
-            string chaseSPAction = "chaseSP" + id + world;
-            string patrolAction = "patrol" + id + world;
-            string returnAction = "return" + id + world;
-
-
-            Vec2 guardPos = _guardSet[i]->getNodePosition();
-            float distance = guardPos.distance(_charPos);
-            int charDirection = calculateMappedAngle(guardPos.x, guardPos.y, _charPos.x, _charPos.y);
-            int guardFacingDirection = _guardSet[i]->getDirection();
-            bool insideVisionCone = false;
-            if ((guardFacingDirection + 8 -2) %8 == charDirection ||(guardFacingDirection + 8 -1) %8 == charDirection ||  (guardFacingDirection + 8 +2) %8 == charDirection ||(guardFacingDirection + 8 + 1) % 8 == charDirection || guardFacingDirection == charDirection) {
-                insideVisionCone = true;
-            }
-            bool visual_detection = false;
-            if (distance < 300 and _world->isActive() and insideVisionCone){
-                // visual_detection = !_world->lineInObstacle(guardPos,_charPos);
-                visual_detection = !_items->lineInObstacle(guardPos, _charPos);
-            }
-
-            bool acoustic_detection = false;
-            if (distance < 150 and _world->isActive()) {
-                acoustic_detection = true;
-            }
-
-
+    /**
+     * Moves every guard one frame further.
+     *
+     * All guard timers advance by `dt`, so the guards behave the same no
+     * matter how long the frames take in real time. The guards are
+     * simulated in _core first, and their views follow once at the end.
+     *
+     * @param _charPos      The position of the character
+     * @param char_angle    The angle of the character
+     * @param scene         The scene of this world
+     * @param dt            The seconds since the last frame
+     */
+    void patrol(Vec2 _charPos, float char_angle, shared_ptr<cugl::Scene2> scene, float dt){
+        auto start = std::chrono::steady_clock::now();
+
+        // the question value counts in milliseconds
+        float elapsed_question_value = dt * 1000;
+
+        // hand out the paths searched since the last update
+        integratePaths();
+        
+        // range and vision cone of every guard in one pass
+        if (_world->isActive()) {
+            _core.perceive(_charPos, VISION_RANGE, HEARING_RANGE, _senses);
+        }
+        else {
+            _senses.assign(_core.size(), 0);
+        }
+        _core.tick(dt);
 
+        for (int i = 0; i < _core.size(); i++){
 
+            Vec2 guardPos = _core.position(i);
+            // only guards with the character in their cone pay for the raycast
+            bool visual_detection = (_senses[i] & GuardCore::MAY_SEE) && canSee(guardPos, _charPos);
+            bool acoustic_detection = (_senses[i] & GuardCore::HEARS) != 0;
 
 #pragma mark Guard State Updates
 
-            // static state
-            if (_guardSet[i]->state == "static") {
-           //     CULog("static");
-                if (visual_detection || acoustic_detection) {
-
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->updateState("question");
-                    last_time_question_value = now;
-                    _guardSet[i]->setQuestionValue(0);
-                    _guardSet[i]->setStateBeforeQuestion("static");
-                }
-
-//                if (visual_detection) {
-//                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-//                    _guardSet[i]->updateState("chaseD");
-//                }
-//                else if (acoustic_detection) {
-//                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-//                    _guardSet[i]->updateState("question");
-//                    last_time_question = now;
-//                    _guardSet[i]->setStateBeforeQuestion("static");
-//                }
-                else {
-                    // keep static
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                }
-            }
+            _core.prevState[i] = _core.state[i];
 
-            // question state
-            else if (_guardSet[i]->state == "question") {
-          //      CULog("question");
-
-                int current_question_value = _guardSet[i]->getQuestionValue();
-                // chose one rate
-                if (visual_detection) {
-                    // one second if it sees
-                    current_question_value = current_question_value + (elapsed_question_value.count() * 2);
-                } else if (acoustic_detection) {
-                    // three seconds if it hears
-                    current_question_value = current_question_value + (elapsed_question_value.count() * 1.6);
-                } else {
-                    // three seconds if nothing happen
-                    current_question_value = current_question_value - elapsed_question_value.count();
-                }
-                last_time_question_value = now;
-                _guardSet[i]->setQuestionValue(current_question_value);
-
-                if (current_question_value > 3000 && visual_detection) {
-                    // chase immediately
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->stopQuestionAnim(id);
-                    _guardSet[i]->updateState("chaseD");
-                }
-                else if (current_question_value > 3000 && acoustic_detection) {
-                    // chase in shortest path
-              //      CULog("switch to chaseSP from question");
-                    _guardSet[i]->stopQuestionAnim(id);
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-
-                    int start = findClosestNode(_guardSet[i]->getNodePosition());
-                    int finish = findClosestNode(_charPos);
-
-//                    CULog("start: %d", start);
-//                    CULog("finish : %d", finish);
-                    vector<Vec2> sp =  shortestPath(start, finish);
-                    _guardSet[i]->setChaseVec(sp);
-                    _guardSet[i]->eraseChaseSPVec();
-//                    CULog("chase SP shortest path cycle");
-//                    for(int i=0; i < sp.size(); i++) {
-//                        CULog( "x: %f, y: %f", sp.at(i).x, sp.at(i).y );
-//                    }
-
-                    _guardSet[i]->updateState("chaseSP");
-                }
-
-                else if (current_question_value >= 0 && current_question_value <= 3000) {
-                    // keep question
-                    // CULog("question");
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                }
-
-                else {
-                    // return to the previous state
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-        //            CULog( " state before question: %s", _guardSet[i]->getStateBeforeQuestion().c_str());
-                    _guardSet[i]->updateState(_guardSet[i]->getStateBeforeQuestion());
-                    if (_guardSet[i]->getStateBeforeQuestion() == "question") {
-                        last_time_question_value = now;
-                        _guardSet[i]->setQuestionValue(0);
+            switch (_core.state[i]) {
+                case GuardState::STATIC:
+                    if (visual_detection || acoustic_detection) {
+                        changeState(i, GuardState::QUESTION, _charPos);
                     }
+                    break;
+
+                case GuardState::QUESTION: {
+                    float current_question_value = _core.question[i];
+                    // chose one rate
+                    if (visual_detection) {
+                        // one second if it sees
+                        current_question_value = current_question_value + (elapsed_question_value * 2);
+                    } else if (acoustic_detection) {
+                        // three seconds if it hears
+                        current_question_value = current_question_value + (elapsed_question_value * 1.6f);
+                    } else {
+                        // three seconds if nothing happen
+                        current_question_value = current_question_value - elapsed_question_value;
+                    }
+                    _core.question[i] = current_question_value;
 
-                }
-            }
-
-            else if (_guardSet[i]->state == "chaseD") {
-      //          CULog("chaseD");
-                //go to lookaround if no detection
-                if (!visual_detection){
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->updateState("lookaround");
-                    last_time_lookaround = now;
-                }
-                else{
-                    //keep chasing otherwise
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                }
-            }
-
-            else if (_guardSet[i]->state == "chaseSP") {
-       //         CULog("chaseSP");
-                if (visual_detection) {
-        //            CULog("switch from chaseSP to chaseD");
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->updateState("chaseD");
+                    if (current_question_value > 3000 && visual_detection) {
+                        // chase immediately
+                        changeState(i, GuardState::CHASE_D, _charPos);
+                    }
+                    else if (current_question_value > 3000 && acoustic_detection) {
+                        // chase in shortest path
+                        changeState(i, GuardState::CHASE_SP, _charPos);
+                    }
+                    else if (current_question_value < 0 || current_question_value > 3000) {
+                        // return to the previous state
+                        changeState(i, _core.beforeQuestion[i], _charPos);
+                    }
+                    break;
                 }
 
-                else if (_guardSet[i]->chaseVec.size() == 0 ){
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->updateState("lookaround");
-                    last_time_lookaround = now;
-                    _guardSet[i]->setIfQuestionInSP(false);
-                }
+                case GuardState::CHASE_D:
+                    //go to lookaround if no detection
+                    if (!visual_detection){
+                        changeState(i, GuardState::LOOKAROUND, _charPos);
+                    }
+                    break;
 
-                else if (acoustic_detection) {
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    if (_guardSet[i]->getIfQuestionInSP() == false) {
-                        CULog("start question while chaseSP");
-                        _guardSet[i]->setIfQuestionInSP(true);
-                        start_question_inSP = now;
+                case GuardState::CHASE_SP:
+                    if (visual_detection) {
+                        changeState(i, GuardState::CHASE_D, _charPos);
+                    }
+                    else if (_core.chaseRoute[i].empty() && !_core.isMoving(i, GuardCore::Move::CHASE_SP)){
+                        changeState(i, GuardState::LOOKAROUND, _charPos);
                     }
-                    else{
-                        if (elapsed_question_inSP.count() <= 2) {
-                            // continue
+                    else if (acoustic_detection) {
+                        if (!_core.hearing[i]) {
+                            CULog("start question while chaseSP");
+                            _core.hearing[i] = true;
+                            _core.heard[i] = 0;
                         }
-                        else {
-            //                CULog("recalculate chaseSP");
-                            Vec2 pos = _guardSet[i]->getNodePosition();
-                            _actions->remove(chaseSPAction);
-                            _actions->remove("guard_animation");
-                            _guardSet[i]->updatePosition(pos);
-
-                            int start = findClosestNode(_guardSet[i]->getNodePosition());
-                            int finish = findClosestNode(_charPos);
-
-//                            CULog("start: %d", start);
-//                            CULog("finish : %d", finish);
-                            vector<Vec2> sp =  shortestPath(start, finish);
-                            _guardSet[i]->setChaseVec(sp);
-                            _guardSet[i]->eraseChaseSPVec();
-
-//                            CULog("chase SP shortest path cycle");
-//                            for(int i=0; i < sp.size(); i++) {
-//                                CULog( "x: %f, y: %f", sp.at(i).x, sp.at(i).y );
-//                            }
-
-                            _guardSet[i]->setIfQuestionInSP(false);
+                        else if (_core.heard[i] >= REPLAN_TIME) {
+                            // recalculate the path to where the character is heard now
+                            stopMove(i);
+                            planChase(i, _charPos, true);
+                            _core.hearing[i] = false;
                         }
                     }
-                }
-
-                else {
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->setIfQuestionInSP(false);
-                }
-
-            }
-
-            else if (_guardSet[i]->state == "lookaround") {
-           //     CULog("lookaround");
-                // maybe wider visual detection
-                if (visual_detection || acoustic_detection) {
-
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->updateState("question");
-                    last_time_question_value = now;
-                    _guardSet[i]->setQuestionValue(0);
-                    _guardSet[i]->setStateBeforeQuestion("lookaround");
-                }
-
-                else if (elapsed_lookaround.count() <= 2){
-                    // keep lookaround
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                }
-                else if (elapsed_lookaround.count() > 2) {
-                    int start = findClosestNode(_guardSet[i]->getNodePosition());
-                    int finish;
-                    Vec2 true_point;
-                    if (!_guardSet[i]->doesPatrol){
-                        true_point = _guardSet[i]->getStaticPosition();
-                        finish = findClosestNode(_guardSet[i]->getStaticPosition());
-                    }else {
-                        true_point = _guardSet[i]->getSavedStop();
-                        finish = findClosestNode(_guardSet[i]->getSavedStop());
+                    else {
+                        _core.hearing[i] = false;
                     }
+                    break;
 
-                    vector<Vec2> sp = shortestPath(start, finish);
-
-                    if (sp.size() > 1) {
-                        sp.erase(sp.begin());
+                case GuardState::LOOKAROUND:
+                    // maybe wider visual detection
+                    if (visual_detection || acoustic_detection) {
+                        changeState(i, GuardState::QUESTION, _charPos);
                     }
+                    else if (_core.lookaround[i] >= LOOKAROUND_TIME) {
+                        changeState(i, GuardState::RETURN, _charPos);
+                    }
+                    break;
 
-                     sp.pop_back();
-                     sp.push_back(true_point);
-
-
-                    _guardSet[i]->setReturnVec(sp);
-
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->updateState("return");
-
-                }
-            }
-
-            //patrol state
-            else if (_guardSet[i]->state == "patrol"){
-            //    CULog("patrol");
-                //detection in patrol state = chase
-
-                if (visual_detection || acoustic_detection) {
-
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->updateState("question");
-
-                    Vec2 pos =  _guardSet[i]->getNodePosition();
-                    _actions->remove(patrolAction);
-                    _guardSet[i]->updatePosition(pos);
-
-                    last_time_question_value = now;
-                    _guardSet[i]->setQuestionValue(0);
-                    _guardSet[i]->setStateBeforeQuestion("patrol");
-                    _guardSet[i]->saveCurrentStop();
-                }
-
-//                if (visual_detection){
-//                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-//                    _guardSet[i]->updateState("chaseD");
-//                    _guardSet[i]->saveCurrentStop();
-//                }
-//                else if (acoustic_detection){
-//                    // if did not see, but hear
-//                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-//                    _guardSet[i]->updateState("question");
-//                    Vec2 pos =  _guardSet[i]->getNodePosition();
-//                    _actions->remove(patrolAction);
-//                    _guardSet[i]->updatePosition(pos);
-//                    last_time_question = now;
-//                    _guardSet[i]->setStateBeforeQuestion("patrol");
-//
-//                    _guardSet[i]->saveCurrentStop();
-//
-//                }
-
-                //keep patroling otherwise
-                else{
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                }
-                
-            }
-
-            
-            else if (_guardSet[i]->state == "return"){
-        //        CULog("return");
-                if (visual_detection || acoustic_detection) {
-
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->updateState("question");
-                    last_time_question_value = now;
-                    _guardSet[i]->setQuestionValue(0);
-
-                    Vec2 pos = _guardSet[i]->getNodePosition();
-                    _actions->remove(returnAction);
-                    _guardSet[i]->updatePosition(pos);
-
-                    _guardSet[i]->setStateBeforeQuestion("return");
-                }
+                case GuardState::PATROL:
+                    //detection in patrol state = question
+                    if (visual_detection || acoustic_detection) {
+                        changeState(i, GuardState::QUESTION, _charPos);
+                    }
+                    break;
 
-//                if (visual_detection){
-//                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-//                    _guardSet[i]->updateState("chaseD");
-//                }
-//                else if (acoustic_detection){
-//                    // if did not see, but hear
-//                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-//                    _guardSet[i]->updateState("question");
-//                    last_time_question = now;
-//                    _guardSet[i]->setStateBeforeQuestion("return");
-//                }
-
-
-                //state change from return to patrol
-                else if (_guardSet[i]->returnVec.size() == 0 and _guardSet[i]->doesPatrol){
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->updateState("patrol");
-                    Vec2 pos = _guardSet[i]->getNodePosition();
-                    _actions->remove(returnAction);
-                    _guardSet[i]->updatePosition(pos);
-                }
-                else if (_guardSet[i]->returnVec.size() == 0 and !_guardSet[i]->doesPatrol){
-                    Vec2 pos = _guardSet[i]->getNodePosition();
-                    _actions->remove(returnAction);
-                    _guardSet[i]->updatePosition(pos);
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->updateState("static");
-                }
-                //otherwise continue returning
-                else{
-                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                }
+                case GuardState::RETURN:
+                    if (visual_detection || acoustic_detection) {
+                        changeState(i, GuardState::QUESTION, _charPos);
+                    }
+                    //still waiting for the path or walking the last part of it
+                    else if (_core.ticket[i] != PathService::NO_TICKET || _core.isMoving(i, GuardCore::Move::RETURN)){
+                        // keep returning
+                    }
+                    //state change from return to patrol or to the post
+                    else if (_core.returnRoute[i].empty()){
+                        changeState(i, _core.patrols[i] ? GuardState::PATROL : GuardState::STATIC, _charPos);
+                    }
+                    break;
             }
 
-            auto elapsed_lookaround = std::chrono::duration_cast<std::chrono::seconds>(now - last_time_lookaround);
-            auto elapsed_question_inSP = std::chrono::duration_cast<std::chrono::seconds>(now - start_question_inSP);
-
 #pragma mark Guard action according to state
 
-
-
-            if (_guardSet[i]->state == "static") {
-                Vec2 pos = _guardSet[i]->getNodePosition();
-                _actions->remove(patrolAction);
-                _actions->remove(chaseSPAction);
-                _actions->remove(chaseDAction);
-                _guardSet[i]->updatePosition(pos);
-                _guardSet[i]->stopQuestionAnim(id);
-                _guardSet[i]->staticGuardAnim(id);
-
-                _guardSet[i]->stop_exclamation();
-
-            }
-            else if (_guardSet[i]->state == "question") {
-                Vec2 pos = _guardSet[i]->getNodePosition();
-                _actions->remove(patrolAction);
-                _actions->remove(chaseSPAction);
-                _actions->remove(chaseDAction);
-                _guardSet[i]->updatePosition(pos);
-                _guardSet[i]->questionAnim(id, _guardSet[i]->getQuestionValue());
-                _guardSet[i]->stop_exclamation();
-
-            }
-            else if (_guardSet[i]->state == "lookaround") {
-                Vec2 pos = _guardSet[i]->getNodePosition();
-                _actions->remove(patrolAction);
-                _actions->remove(chaseSPAction);
-                _actions->remove(chaseDAction);
-                _guardSet[i]->updatePosition(pos);
-                _guardSet[i]->lookAroundAnim(id);
-                _guardSet[i]->stop_exclamation();
-
-            }
-            // return state
-            else if (_guardSet[i]->state == "return"){
-                if (_actions->isActive(returnAction)) {
-                    // let it finish
-                }
-                else if (_guardSet[i]->returnVec.empty()) {
-                    // finish returning
-                }
-                else {
-                    _guardSet[i]->setChaseSpeed(120);
-                    _guardSet[i]->updateReturnTarget(_guardSet[i]->returnVec[0]);
-                    _guardSet[i]->returnGuard(returnAction);
-                    // erase from return vector
-                    _guardSet[i]->eraseReturnVec();
-                }
-
-                _guardSet[i]->returnGuardAnim(id);
-                _guardSet[i]->stop_exclamation();
-
+            if (GuardStates::info(_core.state[i]).halts) {
+                // standing guards drop whatever move they were making
+                stopMove(i);
             }
-            //patrol state
-            else if (_guardSet[i]->state == "patrol" and _guardSet[i]->doesPatrol){
-
-                if(_actions->isActive(patrolAction)){
-                    // guard is moving properly, wait till finished
-                    _guardSet[i]->updatePosition(_guardSet[i]->getNodePosition());
-                }
-                else{
-                    // guard is done moving, set next stop
-                    _guardSet[i]->nextStop(patrolAction);
-
-                }
-                _guardSet[i]->patrolGuardAnim(id);
-                _guardSet[i]->stop_exclamation();
-
-            }
-
-
-
-            //detection for active guard
-            else if (_guardSet[i]->state == "chaseD" and _actions->isActive(patrolAction)){
-                Vec2 pos = _guardSet[i]->getNodePosition();
-                _guardSet[i]->saveCurrentStop();
-                _actions->remove(patrolAction);
 
-                _guardSet[i]->updatePosition(pos);
-                _guardSet[i]->start_exclamation();
-            }
-            //detection for static guard
-            else if (_guardSet[i]->state == "chaseD"){
-                if (_actions->isActive(chaseDAction)) {
-                    // wait for it to finish
-                }
-                else {
-                    _guardSet[i]->updateChaseSpeed(5);
-                    Vec2 pos = _guardSet[i]->getNodePosition();
+            switch (_core.state[i]) {
+                case GuardState::RETURN:
+                    if (!_core.isMoving(i, GuardCore::Move::RETURN) && !_core.returnRoute[i].empty()) {
+                        _core.chaseSpeed[i] = GuardCore::CHASE_SPEED;
+                        _core.startMove(i, GuardCore::Move::RETURN, _core.returnRoute[i][0], GuardCore::WALK_SPEED);
+                        // erase from return vector
+                        _core.returnRoute[i].erase(_core.returnRoute[i].begin());
+                    }
+                    break;
 
-                    _actions->remove(chaseSPAction);
-                    _actions->remove(chaseDAction);
-                    _guardSet[i]->updatePosition(pos);
+                case GuardState::PATROL:
+                    if (_core.patrols[i] && !_core.isMoving(i, GuardCore::Move::PATROL)) {
+                        // guard is done moving, set next stop
+                        _core.nextStop(i);
+                    }
+                    break;
+
+                case GuardState::CHASE_D:
+                    if (!_core.isMoving(i, GuardCore::Move::CHASE_D)) {
+                        _core.speedUpChase(i, 5);
+                        Vec2 target = guardPos + (_charPos - guardPos).getNormalization()*50;
+                        // chase
+                        _core.startMove(i, GuardCore::Move::CHASE_D, target, _core.chaseSpeed[i]);
+                    }
+                    break;
+
+                case GuardState::CHASE_SP:
+                    if (!_core.isMoving(i, GuardCore::Move::CHASE_SP) && !_core.chaseRoute[i].empty()) {
+                        _core.speedUpChase(i, 5);
+                        _core.startMove(i, GuardCore::Move::CHASE_SP, _core.chaseRoute[i][0], _core.chaseSpeed[i]);
+                        // erase from chase vector
+                        _core.chaseRoute[i].erase(_core.chaseRoute[i].begin());
+                    }
+                    break;
 
-                    Vec2 target = guardPos + ((_charPos - guardPos)/distance)*50;
-                    // chase
-                    _guardSet[i]->updateChaseTarget(target);
-                    _guardSet[i]->chaseChar(chaseDAction);
-                }
-                _guardSet[i]->chaseGuardAnim(id);
-                _guardSet[i]->start_exclamation();
+                default:
+                    break;
             }
-            else if (_guardSet[i]->state == "chaseSP"){
-                if (_actions->isActive(chaseSPAction)) {
-                    // wait for it to finish
-            //        CULog("in the process of chase SP");
-                    _guardSet[i]->chaseGuardAnim(id);
-                }
-
-                else {
-                    _guardSet[i]->updateChaseSpeed(5);
-                    _guardSet[i]->updateChaseSPTarget(_guardSet[i]->chaseVec[0]);
-                    _guardSet[i]->chaseChar(chaseSPAction);
-                    _guardSet[i]->chaseGuardAnim(id);
-             //       CULog("start chasing from %f  %f to %f  %f ", _guardSet[i]->getNodePosition().x, _guardSet[i]->getNodePosition().y,_guardSet[i]->chaseVec[0].x, _guardSet[i]->chaseVec[0].y );
-                    // erase from return vector
-                    _guardSet[i]->eraseChaseSPVec();
-                }
 
-                _guardSet[i]->start_exclamation();
-            }
+            _core.prevDir[i] = _core.dir[i];
+            _core.dir[i] = _core.facing(i);
+        }
 
-            Vec2 pos = _guardSet[i]->getNodePosition();
-            _guardSet[i]->updatePosition(pos);
+        // every move advances in one pass, and the broadphase follows
+        _core.step(dt);
+        updateGuardTree();
+        auto simulated = std::chrono::steady_clock::now();
 
-            
+        syncViews();
+        auto synced = std::chrono::steady_clock::now();
+        _lastSimMillis = std::chrono::duration<double, std::milli>(simulated - start).count();
+        _lastSyncMillis = std::chrono::duration<double, std::milli>(synced - simulated).count();
+        report(_lastSimMillis, _lastSyncMillis);
+    }
+    
+    /** Copies the simulated state of every guard into its view */
+    void syncViews() {
+        for (int i = 0; i < _guardSet.size(); i++) {
+            _guardSet[i]->sync(_core.position(i), _core.dir[i], _core.prevDir[i],
+                               _core.state[i], _core.prevState[i], _core.question[i]);
+        }
+    }
+    
+#pragma mark Guard State Machine
+public:
+    /**
+     * Moves a guard to another state, running the exit hook of the old state
+     * and the enter hook of the new one.
+     *
+     * The change must be allowed by the table in GuardStates.
+     *
+     * @param i         The index of the guard in _guardSet
+     * @param next      The state to change to
+     * @param charPos   The position of the character
+     */
+    void changeState(int i, GuardState next, Vec2 charPos) {
+        GuardState from = _core.state[i];
+        CUAssertLog(GuardStates::canChange(from, next), "guard %d cannot change from %s to %s",
+                    _guardSet[i]->id, GuardStates::name(from), GuardStates::name(next));
+        exitState(i, from);
+        _core.state[i] = next;
+        enterState(i, from, next, charPos);
+    }
+    
+    /**
+     * Runs the bookkeeping of guard `i` leaving `state`.
+     *
+     * The question mark is hidden by the view, which sees the state change.
+     */
+    void exitState(int i, GuardState state) {
+        switch (state) {
+            case GuardState::CHASE_SP:
+                _core.hearing[i] = false;
+                break;
+            case GuardState::PATROL:
+                stopMove(i);
+                _core.saveStop(i);
+                break;
+            case GuardState::RETURN:
+                stopMove(i);
+                break;
+            default:
+                break;
+        }
+    }
+    
+    /**
+     * Runs the bookkeeping of a guard entering `state` from `from`.
+     *
+     * A guard that goes back to look around or to return after a question
+     * carries on where it stopped.
+     */
+    void enterState(int i, GuardState from, GuardState state, Vec2 charPos) {
+        bool resumes = from == GuardState::QUESTION;
+        switch (state) {
+            case GuardState::QUESTION:
+                _core.question[i] = 0;
+                _core.beforeQuestion[i] = from;
+                break;
+            case GuardState::CHASE_SP:
+                planChase(i, charPos, false);
+                break;
+            case GuardState::LOOKAROUND:
+                if (!resumes) {
+                    _core.lookaround[i] = 0;
+                }
+                break;
+            case GuardState::RETURN:
+                if (!resumes) {
+                    // the path is searched in the background, the guard waits until it arrives
+                    requestReturn(i, _core.position(i), _core.home(i));
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    
+    /** Stops the move of guard `i`, which stays where it is */
+    void stopMove(int i) {
+        _core.move[i] = GuardCore::Move::NONE;
+    }
+    
+    /**
+     * Gives guard `i` the path to where the character is, without the node it stands on.
+     *
+     * @param replan    Whether the guard is already chasing and heard the character again
+     */
+    void planChase(int i, Vec2 charPos, bool replan) {
+        vector<Vec2>& route = _core.chaseRoute[i];
+        route = chasePath(i, _core.position(i), charPos, replan);
+        if (!route.empty()) {
+            route.erase(route.begin());
+        }
+    }
+    
+#pragma mark Helpers
+public:
+    /**
+     * Calls `callback` with the index of every guard whose proxy overlaps `area`.
+     *
+     * The proxies are grown by TREE_MARGIN, so the callback still has to run
+     * the exact test. It returns false to stop the query early.
+     */
+    template <typename Callback>
+    void queryGuards(const Rect& area, Callback callback) {
+        _guardTree.query(area, callback);
+    }
+    
+    /** Moves the guard proxies to where the guards are now */
+    void updateGuardTree() {
+        for (int i = 0; i < _core.size(); i++) {
+            _guardTree.moveProxy(_guardProxies[i], Rect(_core.position(i), Size::ZERO));
         }
     }
     
+    /**
+     * Returns the node closest to the given position.
+     *
+     * Nodes that are blocked by obstacles are skipped, so the guards never
+     * path from or towards a node that has no edges.
+     */
     int findClosestNode(Vec2 pos){
-     //   CULog("original postion: %f  %f", pos.x, pos.y);
-        int closest = 0;
-        int minDistance = 100000000;
-        for (int i = 0; i < _nodes.size(); i++){
-            int dis = pos.distance(_nodes[i]);
-            if (dis < minDistance){
-                minDistance = dis;
-                closest = i;
-            }
+        return _navQuery->closestNode(pos);
+    }
+    
+    
+    /**
+     * Returns the path from a guard at `from` to the player at `to`.
+     *
+     * On a nav mesh this is the exact shortest path; on the lattice it runs
+     * between the nodes closest to both ends.
+     *
+     * @param guard     The index of the guard in _guardSet
+     * @param replan    Whether the guard is already chasing, see `replanPath`
+     */
+    vector<Vec2> chasePath(int guard, Vec2 from, Vec2 to, bool replan){
+        if (_navMesh != nullptr) {
+            return meshPath(from, to);
         }
-        return closest;
+        int start = findClosestNode(from);
+        int end = findClosestNode(to);
+        return replan ? replanPath(guard, start, end) : fieldPath(start, end);
     }
     
+    /**
+     * Returns the path from `start` to the player's node `end` on the chase field.
+     *
+     * Every guard that starts a chase reads its route from the same flow
+     * field, which is only rebuilt when the player moves onto a different
+     * node. Guards that notice the player together share one search.
+     */
+    vector<Vec2> fieldPath(int start, int end){
+        _chaseField.update(*_graph, end);
+        bool found = _chaseField.extractPath(start, _nodePath);
+        return toPath(found, _nodePath, end);
+    }
     
-    vector<Vec2> shortestPath(int start, int end){
-        int n = _nodes.size();
-        vector<int> dist(n, 1e9);
-        dist[start] = 0;
-
-        // initialize parent vector
-        vector<int> parent(n, -1);
-
-        // initialize queue
-        queue<int> q;
-        q.push(start);
-
-        while (!q.empty()) {
-            int u = q.front();
-            q.pop();
-
-            for (int v = 0; v < n; v++) {
-                if (_adjMatrix[u][v] && dist[u] + 1 < dist[v]) {
-                    dist[v] = dist[u] + 1;
-                    parent[v] = u;
-                    q.push(v);
-                }
-            }
+    /**
+     * Returns the path from `start` to the player's node `end` for a guard
+     * that is already chasing.
+     *
+     * The guard keeps its own D* Lite search for the rest of the chase,
+     * which only repairs the part of the route that its and the player's
+     * moves since the last plan have changed. The chase field would search
+     * the whole graph again whenever the player has moved on.
+     *
+     * Building with CHASE_CHECK defined repeats every re-plan as a fresh
+     * search, asserts that both find equally short paths, and logs how many
+     * nodes each expanded.
+     */
+    vector<Vec2> replanPath(int guard, int start, int end){
+        if (guard >= _chasePlanners.size()) {
+            _chasePlanners.resize(_core.size());
         }
+        bool found = _chasePlanners[guard].findPath(*_graph, start, end, _nodePath);
+#ifdef CHASE_CHECK
+        auto length = [this](const vector<int>& nodes) {
+            float sum = 0;
+            for (int k = 1; k < nodes.size(); k++) {
+                sum += _graph->position(nodes[k - 1]).distance(_graph->position(nodes[k]));
+            }
+            return sum;
+        };
+        DStarLite fresh;
+        vector<int> check;
+        bool freshFound = fresh.findPath(*_graph, start, end, check);
+        CUAssertLog(found == freshFound && std::fabs(length(_nodePath) - length(check)) < 0.01f,
+                    "guard %d re-planned a longer path than a fresh search", guard);
+        CULog("Chase re-plan of guard %d: %d nodes expanded, %d by a fresh search",
+              guard, _chasePlanners[guard].getExpanded(), fresh.getExpanded());
+#endif
+        return toPath(found, _nodePath, end);
+    }
 
-        // backtrack from end to start to get path
-        vector<Vec2> path;
-        int curr = end;
-        while (curr != -1) {
-            path.push_back(_nodes[curr]);
-            curr = parent[curr];
+    
+    /**
+     * Collapses the waypoints of a lattice path that the guard can see past.
+     *
+     * Each waypoint becomes its own move, so fewer waypoints means fewer
+     * turns and straighter motion. The first and last node are kept.
+     */
+    void smoothPath(vector<Vec2>& path){
+        PathSmoother::smooth(path, [this](const Vec2& a, const Vec2& b) {
+            return !canSee(a, b);
+        });
+    }
+    
+    /**
+     * Returns true if nothing blocks the straight line between two points.
+     *
+     * Points on nav nodes are looked up in the visibility matrix; any other
+     * point is raycast against the obstacles.
+     */
+    bool canSee(const Vec2& a, const Vec2& b){
+        if (_visibility != nullptr) {
+            return _visibility->canSee(*_graph, *_navQuery, a, b, [this](const Vec2& from, const Vec2& to) {
+                return _items->lineInObstacle(from, to);
+            });
         }
-        reverse(path.begin(), path.end());
-
-
-//        CULog("inside shortest path");
-//        for(int i=0; i < path.size(); i++) {
-//            CULog( "x: %f, y: %f", path.at(i).x, path.at(i).y );
-//        }
-
-
-
-        return path;
+        return !_items->lineInObstacle(a, b);
     }
-
-
-    int calculateMappedAngle(float x1, float y1, float x2, float y2)
-    {
-        // calculate the angle in radians
-        double angleRadians = atan2(y2 - y1, x2 - x1);
-
-        // convert the angle to degrees
-        float angleDegrees = angleRadians * 180.0 / M_PI;
-
-        // make sure the angle is between 0 and 360 degrees
-        if (angleDegrees < 0.0)
-        {
-            angleDegrees += 360.0;
+    
+    /**
+     * Queues the search for a guard's path back to its post.
+     *
+     * Any search the guard was still waiting for is dropped. The guard gets
+     * the path from `integratePaths` in a later update. Nav mesh queries are
+     * cheap enough to answer right away.
+     *
+     * @param guard     The index of the guard in _guardSet
+     * @param from      The position of the guard
+     * @param target    The exact position of the post
+     */
+    void requestReturn(int guard, Vec2 from, Vec2 target){
+        PathService::Ticket old = _core.ticket[guard];
+        if (old != PathService::NO_TICKET) {
+            _paths->cancel(old);
+            _pendingReturns.erase(old);
+            _core.ticket[guard] = PathService::NO_TICKET;
         }
+        if (_navMesh != nullptr) {
+            vector<Vec2> sp = meshPath(from, target);
+            sp.erase(sp.begin());
+            _core.returnRoute[guard] = sp;
+            return;
+        }
+        PathService::Ticket ticket = _paths->request(findClosestNode(from), findClosestNode(target));
+        _pendingReturns[ticket] = {guard, target};
+        _core.ticket[guard] = ticket;
+        _core.returnRoute[guard].clear();
+    }
+    
+    /**
+     * Gives the finished return paths to the guards that asked for them.
+     *
+     * At most `_pathBudget` paths are integrated per update; the rest wait
+     * for the next one.
+     */
+    void integratePaths(){
+        _pathResults.clear();
+        _paths->collect(_pathResults, _pathBudget);
+        for (auto& result : _pathResults) {
+            auto pending = _pendingReturns.find(result.ticket);
+            if (pending == _pendingReturns.end()) {
+                continue;
+            }
+            int i = pending->second.guard;
+            if (i < _core.size() && _core.ticket[i] == result.ticket) {
+                vector<Vec2> sp = toPath(result.found, result.nodes, result.goal);
 
-        // map the angle from 0 to 360 degrees to 0 to 7
+                if (sp.size() > 1) {
+                    sp.erase(sp.begin());
+                }
 
-        if (angleDegrees > 337.5 || angleDegrees < 22.5) {
-            return 2;
-        } else if (angleDegrees >= 22.5 && angleDegrees < 67.5){
-            return 1;
-        }
-        else if (angleDegrees >= 67.5 && angleDegrees < 112.5){
-            return 0;
-        }
-        else if (angleDegrees >= 112.5 && angleDegrees < 157.5){
-            return 7;
+                 sp.pop_back();
+                 sp.push_back(pending->second.target);
+
+                _core.returnRoute[i] = sp;
+                _core.ticket[i] = PathService::NO_TICKET;
+            }
+            _pendingReturns.erase(pending);
         }
-        else if (angleDegrees >= 157.5 && angleDegrees < 202.5){
-            return 6;
+    }
+    
+    /**
+     * Returns the smoothed waypoints of a node path.
+     *
+     * If there is no path, returns just the position of `end` so that the
+     * guard heads straight for it, like the old BFS did.
+     */
+    vector<Vec2> toPath(bool found, const vector<int>& nodes, int end){
+        vector<Vec2> path;
+        if (found) {
+            for (int node : nodes) {
+                path.push_back(_graph->position(node));
+            }
+            smoothPath(path);
         }
-        else if (angleDegrees >= 202.5 && angleDegrees < 247.5){
-            return 5;
+        else {
+            path.push_back(_graph->position(end));
         }
-        else if (angleDegrees >= 247.5 && angleDegrees < 292.5){
-            return 4;
-        }else if (angleDegrees >= 292.5 && angleDegrees < 337.5){
-            return 3;
+        return path;
+    }
+    
+    /**
+     * Returns the nav mesh path from `from` to `to`.
+     *
+     * If `to` cannot be reached, returns `from` and `to` so that the guard
+     * heads straight for it, like `toPath` does.
+     */
+    vector<Vec2> meshPath(Vec2 from, Vec2 to){
+        if (!_navMesh->findPath(from, to, _meshPath)) {
+            return {from, to};
         }
-        return 0;
-
+        return _meshPath;
     }
     
+
+
     void updatePriority(){
         for(auto &guard : _guardSet){
             guard->updatePriority();
         }
     }
+    
+    /** Adds the times of one update to the report, and logs it when it is due */
+    void report(double simMillis, double syncMillis){
+        if (_reportInterval <= 0) {
+            return;
+        }
+        _simMillis += simMillis;
+        _syncMillis += syncMillis;
+        _reportFrames += 1;
+        if (_reportFrames >= _reportInterval) {
+            CULog("Guards: %d, simulation %.3f ms, views %.3f ms per frame",
+                  _core.size(), _simMillis / _reportFrames, _syncMillis / _reportFrames);
+            _reportFrames = 0;
+            _simMillis = 0;
+            _syncMillis = 0;
+        }
+    }
 
 };
 
@@ -0,0 +1,284 @@
+//
+//  DistanceField.h
+//  Tilemap
+//
+//  Sampled distance to the nearest obstacle, for clearance tests.
+//
+
+#ifndef __DISTANCE_FIELD_H__
+#define __DISTANCE_FIELD_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace cugl;
+
+/**
+ * The distance from every point to the nearest obstacle, sampled once per
+ * cell at the cell centre.
+ *
+ * Outside the obstacles a sample is the exact distance, and inside it is
+ * negative. Distance changes by at most the distance moved, so one sample
+ * bounds the distance at any point near it:
+ *
+ *     sample - |point - centre|  <=  distance(point)  <=  sample + |point - centre|
+ *
+ * A clearance test is one texel read whenever the clearance lies outside
+ * those bounds. Only points near the edge of the clearance fall back to the
+ * exact distance over the obstacle rectangles.
+ *
+ * A circle swept along a segment is tested by sphere tracing. At every step
+ * the bound says how far the circle can move and stay clear, so open ground
+ * is crossed in a few reads. Once the circle comes within a fraction of a
+ * cell of an obstacle, the rest of the segment is tested exactly.
+ */
+class DistanceField {
+
+#pragma mark Constants
+public:
+    /** Default width of a cell */
+    static constexpr float DEFAULT_RESOLUTION = 16;
+    /** Cells of empty border around the obstacles */
+    static constexpr int BORDER = 4;
+
+#pragma mark Internal References
+private:
+    /** Bottom left corner of the field */
+    Vec2 _origin;
+    float _cellSize;
+    int _cols;
+    int _rows;
+    /** One sample per cell, row after row */
+    std::vector<float> _samples;
+    /** The obstacles themselves, without the margin */
+    std::vector<float> _minX;
+    std::vector<float> _minY;
+    std::vector<float> _maxX;
+    std::vector<float> _maxY;
+    /** Bounds of all obstacles together */
+    float _left, _bottom, _right, _top;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Samples the distance to the obstacles.
+     *
+     * Takes the obstacle arrays of the item set, which are grown by the
+     * margin, and measures the distance to the obstacles themselves.
+     *
+     * @param minX      Left edge of every obstacle grown by the margin
+     * @param minY      Bottom edge of every grown obstacle
+     * @param maxX      Right edge of every grown obstacle
+     * @param maxY      Top edge of every grown obstacle
+     * @param margin    How much the obstacles were grown by
+     * @param cellSize  Width and height of one cell
+     */
+    DistanceField(const std::vector<float>& minX, const std::vector<float>& minY,
+                  const std::vector<float>& maxX, const std::vector<float>& maxY,
+                  float margin, float cellSize = DEFAULT_RESOLUTION) {
+        _cellSize = cellSize > 0 ? cellSize : DEFAULT_RESOLUTION;
+        _cols = 0;
+        _rows = 0;
+        int n = (int)minX.size();
+        for (int i = 0; i < n; i++) {
+            _minX.push_back(minX[i] + margin);
+            _minY.push_back(minY[i] + margin);
+            _maxX.push_back(maxX[i] - margin);
+            _maxY.push_back(maxY[i] - margin);
+        }
+        if (n == 0) {
+            return;
+        }
+
+        _left = *std::min_element(_minX.begin(), _minX.end());
+        _bottom = *std::min_element(_minY.begin(), _minY.end());
+        _right = *std::max_element(_maxX.begin(), _maxX.end());
+        _top = *std::max_element(_maxY.begin(), _maxY.end());
+        float border = BORDER * _cellSize;
+        _origin = Vec2(_left - border, _bottom - border);
+        _cols = (int)std::ceil((_right - _left + 2 * border) / _cellSize);
+        _rows = (int)std::ceil((_top - _bottom + 2 * border) / _cellSize);
+        _samples.resize((size_t)_cols * _rows);
+        for (int row = 0; row < _rows; row++) {
+            for (int col = 0; col < _cols; col++) {
+                _samples[(size_t)row * _cols + col] = exactDistance(centre(col, row));
+            }
+        }
+    }
+
+#pragma mark Queries
+public:
+    /**
+     * Returns true if a circle overlaps an obstacle.
+     *
+     * @param centre    The centre of the circle
+     * @param radius    The clearance the circle needs
+     */
+    bool circleHits(const Vec2& centre, float radius) const {
+        if (_minX.empty()) {
+            return false;
+        }
+        float slack;
+        float sample = read(centre, slack);
+        if (sample - slack >= radius) {
+            return false;
+        }
+        if (sample + slack < radius) {
+            return true;
+        }
+        return exactDistance(centre) < radius;
+    }
+
+    /**
+     * Returns true if a circle moved from `a` to `b` overlaps an obstacle
+     * anywhere along the way.
+     *
+     * @param a         The start of the movement
+     * @param b         The end of the movement
+     * @param radius    The clearance the circle needs
+     */
+    bool sweptCircleHits(const Vec2& a, const Vec2& b, float radius) const {
+        if (_minX.empty()) {
+            return false;
+        }
+        Vec2 d = b - a;
+        float length = d.length();
+        Vec2 dir = length > 0 ? d / length : Vec2::ZERO;
+        // steps shorter than this leave the rest to the exact test
+        float minStep = _cellSize * 0.25f;
+        float t = 0;
+        while (true) {
+            Vec2 p = a + dir * t;
+            float slack;
+            float free = read(p, slack) - slack - radius;
+            if (free < minStep) {
+                return segmentDistance(p, b) < radius;
+            }
+            // every centre within `free` of p is clear
+            t += free;
+            if (t >= length) {
+                return false;
+            }
+        }
+    }
+
+#pragma mark Statistics
+public:
+    /** Returns the number of cells */
+    int cellCount() const {
+        return _cols * _rows;
+    }
+
+    /** Returns the memory taken by the samples in bytes */
+    size_t memoryBytes() const {
+        return _samples.size() * sizeof(float);
+    }
+
+#pragma mark Helpers
+private:
+    Vec2 centre(int col, int row) const {
+        return _origin + Vec2((col + 0.5f) * _cellSize, (row + 0.5f) * _cellSize);
+    }
+
+    /**
+     * Returns the sample of the cell containing `point`, and in `slack` how
+     * far the point is from the sample.
+     *
+     * Points off the field get the distance to the box around all obstacles,
+     * which is never more than the real distance, and no slack.
+     */
+    float read(const Vec2& point, float& slack) const {
+        int col = (int)std::floor((point.x - _origin.x) / _cellSize);
+        int row = (int)std::floor((point.y - _origin.y) / _cellSize);
+        if (col < 0 || row < 0 || col >= _cols || row >= _rows) {
+            slack = 0;
+            float dx = std::max(std::max(_left - point.x, point.x - _right), 0.0f);
+            float dy = std::max(std::max(_bottom - point.y, point.y - _top), 0.0f);
+            return std::sqrt(dx * dx + dy * dy);
+        }
+        slack = point.distance(centre(col, row));
+        return _samples[(size_t)row * _cols + col];
+    }
+
+    /** Returns the distance from a point to obstacle `k`, negative inside it */
+    float rectDistance(int k, const Vec2& p) const {
+        float dx = std::max(_minX[k] - p.x, p.x - _maxX[k]);
+        float dy = std::max(_minY[k] - p.y, p.y - _maxY[k]);
+        if (dx <= 0 && dy <= 0) {
+            return std::max(dx, dy);
+        }
+        dx = std::max(dx, 0.0f);
+        dy = std::max(dy, 0.0f);
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    /**
+     * Returns the distance from a point to the nearest obstacle.
+     *
+     * Inside an obstacle this is the depth into the deepest rectangle, so it
+     * is negative but may be shallower than the real depth.
+     */
+    float exactDistance(const Vec2& p) const {
+        float best = std::numeric_limits<float>::max();
+        for (int k = 0; k < _minX.size(); k++) {
+            best = std::min(best, rectDistance(k, p));
+        }
+        return best;
+    }
+
+    /** Returns the distance from the segment to the nearest obstacle, 0 if it crosses one */
+    float segmentDistance(const Vec2& a, const Vec2& b) const {
+        float best = std::numeric_limits<float>::max();
+        for (int k = 0; k < _minX.size() && best > 0; k++) {
+            if (segmentCrosses(k, a, b)) {
+                return 0;
+            }
+            // the closest points of two disjoint convex shapes include a corner of one of them
+            best = std::min(best, std::max(rectDistance(k, a), 0.0f));
+            best = std::min(best, std::max(rectDistance(k, b), 0.0f));
+            best = std::min(best, pointSegment(Vec2(_minX[k], _minY[k]), a, b));
+            best = std::min(best, pointSegment(Vec2(_maxX[k], _minY[k]), a, b));
+            best = std::min(best, pointSegment(Vec2(_minX[k], _maxY[k]), a, b));
+            best = std::min(best, pointSegment(Vec2(_maxX[k], _maxY[k]), a, b));
+        }
+        return best;
+    }
+
+    /** Returns true if the segment touches obstacle `k` (slab test) */
+    bool segmentCrosses(int k, const Vec2& a, const Vec2& b) const {
+        float t0 = 0, t1 = 1;
+        Vec2 d = b - a;
+        float lo[2] = {_minX[k], _minY[k]};
+        float hi[2] = {_maxX[k], _maxY[k]};
+        float from[2] = {a.x, a.y};
+        float step[2] = {d.x, d.y};
+        for (int axis = 0; axis < 2; axis++) {
+            if (step[axis] == 0) {
+                if (from[axis] < lo[axis] || from[axis] > hi[axis]) {
+                    return false;
+                }
+                continue;
+            }
+            float u0 = (lo[axis] - from[axis]) / step[axis];
+            float u1 = (hi[axis] - from[axis]) / step[axis];
+            t0 = std::max(t0, std::min(u0, u1));
+            t1 = std::min(t1, std::max(u0, u1));
+            if (t0 > t1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static float pointSegment(const Vec2& p, const Vec2& a, const Vec2& b) {
+        Vec2 d = b - a;
+        float len2 = d.lengthSquared();
+        float t = len2 > 0 ? std::min(std::max((p - a).dot(d) / len2, 0.0f), 1.0f) : 0;
+        return p.distance(a + d * t);
+    }
+};
+
+#endif /* __DISTANCE_FIELD_H__ */
@@ -0,0 +1,129 @@
+//
+//  GridWalk.h
+//  Tilemap
+//
+//  Cell by cell walk of a segment over a uniform grid.
+//
+
+#ifndef __GRID_WALK_H__
+#define __GRID_WALK_H__
+
+#include <cugl/cugl.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace cugl;
+
+/**
+ * Walks the cells of a uniform grid that a segment crosses, in order (a 2D
+ * DDA).
+ *
+ * The segment is first clipped to the grid. When it passes exactly through
+ * a cell corner, the two cells beside the corner are visited as well, in
+ * case rounding picked the wrong one; they are flagged so callers that need
+ * certainty can tell them apart.
+ */
+class GridWalk {
+
+#pragma mark Main Methods
+public:
+    /**
+     * Calls `visit(cell, onPath)` for the cells crossed by the segment.
+     *
+     * Cells are numbered `row * cols + col`, with row 0 at `origin`. `onPath`
+     * is false for the extra cells visited beside a corner.
+     *
+     * @param origin    Bottom left corner of the grid
+     * @param cellSize  Width and height of one cell
+     * @param cols      Number of columns
+     * @param rows      Number of rows
+     * @param a         Start of the segment
+     * @param b         End of the segment
+     * @param visit     Returns true to stop the walk
+     *
+     * @return true if `visit` stopped the walk
+     */
+    template <typename Visit>
+    static bool walk(const Vec2& origin, float cellSize, int cols, int rows, const Vec2& a, const Vec2& b, Visit visit) {
+        if (cols <= 0 || rows <= 0) {
+            return false;
+        }
+        float t0 = 0, t1 = 1;
+        Vec2 d = b - a;
+        if (!clip(-d.x, a.x - origin.x, t0, t1) || !clip(d.x, origin.x + cols * cellSize - a.x, t0, t1) ||
+            !clip(-d.y, a.y - origin.y, t0, t1) || !clip(d.y, origin.y + rows * cellSize - a.y, t0, t1)) {
+            return false;
+        }
+        Vec2 p = a + d * t0;
+        Vec2 q = a + d * t1;
+
+        int col = clampTo((int)std::floor((p.x - origin.x) / cellSize), cols);
+        int row = clampTo((int)std::floor((p.y - origin.y) / cellSize), rows);
+        int endCol = clampTo((int)std::floor((q.x - origin.x) / cellSize), cols);
+        int endRow = clampTo((int)std::floor((q.y - origin.y) / cellSize), rows);
+        int stepX = d.x > 0 ? 1 : -1;
+        int stepY = d.y > 0 ? 1 : -1;
+
+        // parameter along p->q at which the walk crosses the next column and row
+        Vec2 pq = q - p;
+        float inf = std::numeric_limits<float>::infinity();
+        float deltaX = pq.x != 0 ? cellSize / std::fabs(pq.x) : inf;
+        float deltaY = pq.y != 0 ? cellSize / std::fabs(pq.y) : inf;
+        float nextX = pq.x != 0 ? ((origin.x + (col + (stepX > 0 ? 1 : 0)) * cellSize) - p.x) / pq.x : inf;
+        float nextY = pq.y != 0 ? ((origin.y + (row + (stepY > 0 ? 1 : 0)) * cellSize) - p.y) / pq.y : inf;
+
+        int steps = std::abs(endCol - col) + std::abs(endRow - row);
+        for (int s = 0; ; s++) {
+            if (visit(row * cols + col, true)) {
+                return true;
+            }
+            if ((col == endCol && row == endRow) || s > steps) {
+                return false;
+            }
+            if (col != endCol && row != endRow && std::fabs(nextX - nextY) <= 1e-6f) {
+                // through a corner
+                if (visit(row * cols + col + stepX, false) || visit((row + stepY) * cols + col, false)) {
+                    return true;
+                }
+                col += stepX;
+                row += stepY;
+                nextX += deltaX;
+                nextY += deltaY;
+            }
+            else if ((nextX < nextY && col != endCol) || row == endRow) {
+                col += stepX;
+                nextX += deltaX;
+            }
+            else {
+                row += stepY;
+                nextY += deltaY;
+            }
+        }
+    }
+
+#pragma mark Helpers
+private:
+    static int clampTo(int i, int n) {
+        return std::min(std::max(i, 0), n - 1);
+    }
+
+    /** One Liang-Barsky clipping step against the boundary `p * t <= q` */
+    static bool clip(float p, float q, float& t0, float& t1) {
+        if (p == 0) {
+            return q >= 0;
+        }
+        float t = q / p;
+        if (p < 0) {
+            if (t > t1) return false;
+            t0 = std::max(t0, t);
+        }
+        else {
+            if (t < t0) return false;
+            t1 = std::min(t1, t);
+        }
+        return true;
+    }
+};
+
+#endif /* __GRID_WALK_H__ */
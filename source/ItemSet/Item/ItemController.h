@@ -142,6 +142,10 @@ public:
         _view->setVisibility(visible);
     }
     
+    Rect getBounds(){
+        return _view->getBounds();
+    }
+    
     bool containsLine(Vec2 a, Vec2 b){
         return _view->containsLine(a, b);
     }
@@ -151,7 +155,7 @@ public:
         return _view->updatePriority();
     }
 
-    void setAction(std::shared_ptr<cugl::scene2::ActionManager> actions) {
+    void setAction(std::shared_ptr<ActionSlots> actions) {
         _view->setAction(actions);
     }
 
@@ -9,10 +9,15 @@
 #define ItemView_h
 
 #include <cugl/cugl.h>
+#include <Action/ActionSlots.h>
 #include <math.h>
 //using namespace cugl;
 
 class ItemView{
+public:
+    /** How far characters and guards keep away from an obstacle */
+    static constexpr int OBSTACLE_MARGIN = 5;
+
 private:
     /** Main character view */
     /** The node is attached to the root-scene*/
@@ -27,7 +32,9 @@ private:
     std::shared_ptr<cugl::scene2::Animate> _c_0;
 
     /** Manager to process the animation actions */
-    std::shared_ptr<cugl::scene2::ActionManager> _actions;
+    std::shared_ptr<ActionSlots> _actions;
+    /** Handle of the looping animation */
+    ActionSlots::Handle _animation;
 
     int _id;
     
@@ -43,6 +50,7 @@ public:
         _isObs = isObs;
         _isExit = isExit;
         _id = id;
+        _animation = ActionSlots::NO_HANDLE;
 
 
         std::vector<int> d0 = {1,2,3,4,5,6,7,0};
@@ -88,8 +96,9 @@ public:
         _static_node->setPosition(position);
     }
 
-    void setAction(std::shared_ptr<cugl::scene2::ActionManager> actions) {
+    void setAction(std::shared_ptr<ActionSlots> actions) {
         _actions = actions;
+        _animation = _actions->reserve();
     }
 
     void setSize(Size size){
@@ -162,11 +171,11 @@ public:
     }
 
     void updateAnim() {
-        if (_actions->isActive("item"+ std::to_string(_id))){
+        if (_actions->isActive(_animation)){
             // let it finish
         }
         else {
-            _actions->activate("item"+ std::to_string(_id), _c_0, _anim_node);
+            _actions->activate(_animation, _c_0, _anim_node);
         }
 
     }
@@ -188,12 +197,16 @@ public:
         Vec2 global_pos = _static_node->getWorldPosition();
         Size s = _static_node->getSize();
         // Add a offset so that character & guard don't go too close to wall
-        int offset = 5;
+        int offset = OBSTACLE_MARGIN;
         bool hor = (point.x >= global_pos.x - offset && point.x <= global_pos.x + s.width + offset);
         bool ver = (point.y >= global_pos.y - offset && point.y <= global_pos.y + s.height + offset);
         return hor && ver;
     }
     
+    /** Returns the area covered by this item in world coordinates, without the margin */
+    Rect getBounds(){
+        return Rect(_static_node->getWorldPosition(), _static_node->getSize());
+    }
     
     bool containsLine(Vec2 a, Vec2 b){
         
@@ -216,7 +229,7 @@ public:
          
     }
     
-    bool lineLine(float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4) {
+    static bool lineLine(float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4) {
         // calculate the distance to intersection point
         float uA = ((x4-x3)*(y1-y3) - (y4-y3)*(x1-x3)) / ((y4-y3)*(x2-x1) - (x4-x3)*(y2-y1));
         float uB = ((x2-x1)*(y1-y3) - (y2-y1)*(x1-x3)) / ((y4-y3)*(x2-x1) - (x4-x3)*(y2-y1));
@@ -11,6 +11,13 @@
 #include "Item/ItemModel.h"
 #include "Item/ItemView.h"
 #include "Item/ItemController.h"
+#include "ObstacleGrid.h"
+#include "SlabKernel.h"
+#include "OccupancyGrid.h"
+#include "RectMerger.h"
+#include "DistanceField.h"
+#include <Collision/AABBTree.h>
+#include <Nav/ThreadPool.h>
 
 /**
  * A class communicating between the model and the view. It only
@@ -32,6 +39,36 @@ public:
 
     std::vector<int> _usedIDs;
 
+private:
+    /**
+     * The obstacles grown by the margin, in world coordinates, one entry per
+     * obstacle. Obstacles never move after the level is loaded, so the
+     * queries read these instead of the scene graph.
+     */
+    std::vector<float> _obsMinX;
+    std::vector<float> _obsMinY;
+    std::vector<float> _obsMaxX;
+    std::vector<float> _obsMaxY;
+    /** Whether the items changed since the obstacle arrays were built */
+    bool _obsDirty;
+    /** Bucket grid over the obstacle arrays, nullptr if the set is not indexed */
+    std::unique_ptr<ObstacleGrid> _index;
+    /** Cell size of the grid, 0 if the set is not indexed */
+    float _indexCellSize;
+    /** Bitmap of the obstacle layer, nullptr if the set has none */
+    std::unique_ptr<OccupancyGrid> _occupancy;
+    /** Cell size of the bitmap, 0 if the set has none */
+    float _occupancyResolution;
+    /** Distance to the obstacles, nullptr until the set is asked for clearance */
+    std::unique_ptr<DistanceField> _distance;
+    /** Cell size of the distance field, 0 if the set has none */
+    float _distanceResolution;
+    /** Broadphase over the item positions, for overlap queries */
+    AABBTree _itemTree;
+    /** Proxy of every item in _itemTree, by index in _itemSet */
+    std::vector<int> _itemProxies;
+    /** Whether the item tree has to be rebuilt before the next query */
+    bool _itemTreeDirty;
 
 
 
@@ -45,6 +82,11 @@ public:
         ItemSet _itemSet;
         artCount = 0; // init only
         resCount = 0; // init only
+        _indexCellSize = 0;
+        _occupancyResolution = 0;
+        _distanceResolution = 0;
+        _obsDirty = true;
+        _itemTreeDirty = true;
     };
 
 #pragma mark Update Methods
@@ -61,6 +103,8 @@ public:
         int new_id = generateUniqueID();
         Item _item = std::make_unique<ItemController>(pos, size, isArtifact, isResource, isWall, isExit, assets, textureKey, new_id);
         _itemSet.push_back(std::move(_item));
+        _obsDirty = true;
+        _itemTreeDirty = true;
     }
 
     int generateUniqueID() {
@@ -85,6 +129,15 @@ public:
         if (_itemSet[idx]->isArtifact()) {
             _itemSet[idx]->removeChildFrom(s);
             _itemSet.erase(_itemSet.begin() + idx);
+            _obsDirty = true;
+            if (!_itemTreeDirty) {
+                // the items after it move down one place
+                _itemTree.destroyProxy(_itemProxies[idx]);
+                _itemProxies.erase(_itemProxies.begin() + idx);
+                for (int i = idx; i < _itemProxies.size(); i++) {
+                    _itemTree.setUserData(_itemProxies[i], i);
+                }
+            }
         }
         else if (_itemSet[idx]->isResource()) {
             _itemSet[idx]->removeAnim();
@@ -111,6 +164,8 @@ public:
     
     void clearSet () {
         _itemSet.clear();
+        _obsDirty = true;
+        _itemTreeDirty = true;
     }
     
     void setVisibility(bool visible){
@@ -130,6 +185,8 @@ public:
                 _itemSet[i]->updateSize(tileSize);
             }
         }
+        _obsDirty = true;
+        _itemTreeDirty = true;
     }
     
     void setTexture(const std::shared_ptr<cugl::AssetManager>& assets){
@@ -142,6 +199,8 @@ public:
                 }
             }
         }
+        _obsDirty = true;
+        _itemTreeDirty = true;
     }
     
     void updateTransparency(){
@@ -154,29 +213,211 @@ public:
         }
     }
     
+    /**
+     * Caches the obstacles once and builds every structure that answers
+     * queries about them.
+     *
+     * Structures with a size of 0 are left out. Everything is rebuilt on
+     * the next query whenever the items change.
+     *
+     * @param cellSize      Width and height of one bucket grid cell
+     * @param occupancy     Width and height of one occupancy bitmap cell
+     * @param distance      Width and height of one distance field cell
+     */
+    void buildQueries(float cellSize, float occupancy, float distance){
+        _indexCellSize = cellSize;
+        _occupancyResolution = occupancy;
+        _distanceResolution = distance;
+        buildObstacles();
+    }
+
+    /**
+     * Returns true if a circle comes closer to an obstacle than its radius.
+     *
+     * Unlike `inObstacle`, the clearance is measured from the obstacles
+     * themselves, without the fixed margin, and is round at the corners.
+     *
+     * @param centre    The centre of the circle
+     * @param radius    The clearance needed around the centre
+     */
+    bool circleInObstacle(Vec2 centre, float radius){
+        if(_distanceResolution <= 0){
+            // sets that were not given a size use the default one
+            _distanceResolution = DistanceField::DEFAULT_RESOLUTION;
+            _obsDirty = true;
+        }
+        if(_obsDirty){
+            buildObstacles();
+        }
+        return _distance->circleHits(centre, radius);
+    }
+
+    /**
+     * Returns true if a circle moved in a straight line from `a` to `b`
+     * comes closer to an obstacle than its radius anywhere along the way.
+     *
+     * @param a         Where the circle starts
+     * @param b         Where the circle ends
+     * @param radius    The clearance needed around the centre
+     */
+    bool sweptCircleInObstacle(Vec2 a, Vec2 b, float radius){
+        if(_distanceResolution <= 0){
+            // sets that were not given a size use the default one
+            _distanceResolution = DistanceField::DEFAULT_RESOLUTION;
+            _obsDirty = true;
+        }
+        if(_obsDirty){
+            buildObstacles();
+        }
+        return _distance->sweptCircleHits(a, b, radius);
+    }
+
     bool inObstacle(Vec2 point){
-        unsigned int vecSize = _itemSet.size();
-        for(unsigned int i = 0; i < vecSize; i++) {
-            if(_itemSet[i] != nullptr && _itemSet[i]->isObs() && _itemSet[i]->contains(point)){
+        if(_obsDirty){
+            buildObstacles();
+        }
+        if(_occupancy != nullptr){
+            OccupancyGrid::Result result = _occupancy->testPoint(point);
+            if(result != OccupancyGrid::Result::UNSURE){
+                return result == OccupancyGrid::Result::BLOCKED;
+            }
+        }
+        if(_index != nullptr){
+            return _index->anyAt(point, [this, &point](int k) {
+                return pointInObstacle(k, point);
+            });
+        }
+        for(int k = 0; k < _obsMinX.size(); k++){
+            if(pointInObstacle(k, point)){
                 return true;
             }
         }
         return false;
     }
     
+    /**
+     * Calls `callback` with the index of every item whose position lies in `area`.
+     *
+     * The items are found through a bounding volume tree over their node
+     * positions, so only items near `area` are visited. The callback returns
+     * false to stop the query early.
+     */
+    template <typename Callback>
+    void queryItems(const Rect& area, Callback callback){
+        if(_itemTreeDirty){
+            buildItemTree();
+        }
+        _itemTree.query(area, callback);
+    }
+    
     std::shared_ptr<ItemSetController> copy() {
         std::shared_ptr<ItemSetController> temp = std::make_shared<ItemSetController>();
         temp->_itemSet = std::vector<Item>(this->_itemSet);
+        temp->_indexCellSize = _indexCellSize;
+        temp->_occupancyResolution = _occupancyResolution;
+        temp->_distanceResolution = _distanceResolution;
         return temp;
     }
     
     bool lineInObstacle(Vec2 a, Vec2 b){
-        for(auto item: _itemSet){
-            if(item != nullptr && item->isObs() && item->containsLine(a,b)){
-                return true;
+        if(_obsDirty){
+            buildObstacles();
+        }
+        return segmentInObstacle(a, b);
+    }
+
+    /**
+     * Runs `lineInObstacle` on a batch of segments.
+     *
+     * Bit `k % 64` of `hits[k / 64]` is set if segment k, from `starts[k]`
+     * to `ends[k]`, is blocked. With a pool, the segments are shared between
+     * the workers 64 at a time, so each worker writes its own words; the
+     * obstacle snapshot is brought up to date before they start.
+     *
+     * @param starts    The start of every segment
+     * @param ends      The end of every segment
+     * @param hits      Filled with one bit per segment
+     * @param pool      Worker threads to share the segments between, or nullptr
+     */
+    void linesInObstacle(const std::vector<Vec2>& starts, const std::vector<Vec2>& ends, std::vector<uint64_t>& hits, ThreadPool* pool = nullptr){
+        if(_obsDirty){
+            buildObstacles();
+        }
+        int count = (int)std::min(starts.size(), ends.size());
+        int words = (count + 63) / 64;
+        hits.assign(words, 0);
+        auto fillWord = [this, &starts, &ends, &hits, count](int word) {
+            uint64_t bits = 0;
+            for(int k = word * 64; k < std::min(count, word * 64 + 64); k++){
+                if(segmentInObstacle(starts[k], ends[k])){
+                    bits |= (uint64_t)1 << (k % 64);
+                }
+            }
+            hits[word] = bits;
+        };
+        if(pool == nullptr || words < 2){
+            for(int w = 0; w < words; w++){
+                fillWord(w);
             }
+            return;
         }
-        return false;
+        int workers = std::min(pool->size(), words);
+        for(int w = 0; w < workers; w++){
+            pool->submit([&fillWord, w, workers, words](int worker) {
+                for(int word = w; word < words; word += workers){
+                    fillWord(word);
+                }
+            });
+        }
+        pool->wait();
+    }
+
+    /** Rebuilds the obstacle snapshot and its query structures if the items changed */
+    void updateObstacles(){
+        if(_obsDirty){
+            buildObstacles();
+        }
+    }
+
+    /** Returns true if the snapshot matches the items, so the const queries are current */
+    bool obstaclesReady() const {
+        return !_obsDirty;
+    }
+
+    /**
+     * Tests a segment against the current obstacle snapshot.
+     *
+     * Unlike `lineInObstacle` this never rebuilds the snapshot, so several
+     * threads can call it at the same time once `updateObstacles` ran.
+     */
+    bool segmentInObstacle(const Vec2& a, const Vec2& b) const {
+        if(_occupancy != nullptr){
+            OccupancyGrid::Result result = _occupancy->testSegment(a, b);
+            if(result != OccupancyGrid::Result::UNSURE){
+                return result == OccupancyGrid::Result::BLOCKED;
+            }
+        }
+        SlabKernel::Segment segment(a, b);
+        float margin = ItemView::OBSTACLE_MARGIN;
+        if(_index != nullptr){
+            return _index->anyOnSegment(a, b, [&segment, margin](const float* minX, const float* minY, const float* maxX, const float* maxY, int count) {
+                return SlabKernel::anyHit(segment, minX, minY, maxX, maxY, count, margin);
+            });
+        }
+        return SlabKernel::anyHit(segment, _obsMinX.data(), _obsMinY.data(), _obsMaxX.data(), _obsMaxY.data(), (int)_obsMinX.size(), margin);
+    }
+
+    /** Returns the areas covered by the obstacles, for building a nav mesh */
+    std::vector<Rect> getObstacleBounds(){
+        if(_obsDirty){
+            buildObstacles();
+        }
+        std::vector<Rect> bounds;
+        float m = ItemView::OBSTACLE_MARGIN;
+        for(int k = 0; k < _obsMinX.size(); k++){
+            bounds.push_back(Rect(_obsMinX[k] + m, _obsMinY[k] + m, _obsMaxX[k] - _obsMinX[k] - 2 * m, _obsMaxY[k] - _obsMinY[k] - 2 * m));
+        }
+        return bounds;
     }
 
     const int getArtNum(){
@@ -199,7 +440,7 @@ public:
         return resCount;
     }
 
-    void setAction(std::shared_ptr<cugl::scene2::ActionManager> actions){
+    void setAction(std::shared_ptr<ActionSlots> actions){
         unsigned int vecSize = _itemSet.size();
         for(unsigned int i = 0; i < vecSize; i++) {
             if(_itemSet[i] != nullptr){
@@ -225,6 +466,58 @@ public:
             item->updatePriority();
         }
     }
+
+#pragma mark Query Helpers
+private:
+    /**
+     * Reads the obstacle bounds out of the scene graph, and rebuilds the grid and bitmap the set uses.
+     *
+     * Touching obstacles are merged into larger rectangles first, so the
+     * queries test a handful of walls instead of every tile. The items
+     * themselves are left as they are.
+     */
+    void buildObstacles(){
+        std::vector<Rect> bounds;
+        for(const auto& item: _itemSet){
+            if(item != nullptr && item->isObs()){
+                bounds.push_back(item->getBounds());
+            }
+        }
+        bounds = RectMerger::merge(bounds);
+
+        _obsMinX.clear();
+        _obsMinY.clear();
+        _obsMaxX.clear();
+        _obsMaxY.clear();
+        float m = ItemView::OBSTACLE_MARGIN;
+        for(const Rect& r : bounds){
+            // the queries test the rectangle grown by the margin, as ItemView::contains does
+            _obsMinX.push_back(r.origin.x - m);
+            _obsMinY.push_back(r.origin.y - m);
+            _obsMaxX.push_back(r.origin.x + r.size.width + m);
+            _obsMaxY.push_back(r.origin.y + r.size.height + m);
+        }
+        _index = _indexCellSize > 0 ? std::make_unique<ObstacleGrid>(_obsMinX, _obsMinY, _obsMaxX, _obsMaxY, _indexCellSize) : nullptr;
+        _occupancy = _occupancyResolution > 0 ? std::make_unique<OccupancyGrid>(_obsMinX, _obsMinY, _obsMaxX, _obsMaxY, m, _occupancyResolution) : nullptr;
+        _distance = _distanceResolution > 0 ? std::make_unique<DistanceField>(_obsMinX, _obsMinY, _obsMaxX, _obsMaxY, m, _distanceResolution) : nullptr;
+        _obsDirty = false;
+    }
+
+    /** Returns true if the point lies in obstacle `k`, grown by the margin */
+    bool pointInObstacle(int k, const Vec2& point) const {
+        return point.x >= _obsMinX[k] && point.x <= _obsMaxX[k] && point.y >= _obsMinY[k] && point.y <= _obsMaxY[k];
+    }
+
+    /** Inserts every item into a fresh item tree */
+    void buildItemTree(){
+        _itemTree.clear();
+        _itemProxies.clear();
+        for(int i = 0; i < _itemSet.size(); i++){
+            Vec2 pos = _itemSet[i] != nullptr ? _itemSet[i]->getNodePosition() : Vec2::ZERO;
+            _itemProxies.push_back(_itemTree.createProxy(Rect(pos, Size::ZERO), i));
+        }
+        _itemTreeDirty = false;
+    }
 };
 
 
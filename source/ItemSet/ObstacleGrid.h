@@ -0,0 +1,200 @@
+//
+//  ObstacleGrid.h
+//  Tilemap
+//
+//  Uniform bucket grid over the obstacles of an item set.
+//
+
+#ifndef __OBSTACLE_GRID_H__
+#define __OBSTACLE_GRID_H__
+
+#include <cugl/cugl.h>
+#include "GridWalk.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+using namespace cugl;
+
+/**
+ * A uniform grid of buckets over a list of rectangles, given as arrays of
+ * their bounds.
+ *
+ * Every cell lists the rectangles that overlap it, stored as one flat array
+ * with an offset per cell. A point only needs to look at the rectangles of
+ * its own cell, and a segment only at the rectangles of the cells it
+ * crosses, instead of every rectangle of the set.
+ *
+ * Each bucket also keeps a copy of the bounds of its rectangles, so a
+ * segment can run a batched test over a whole bucket without gathering.
+ * A rectangle that spans several cells may be tested once per cell.
+ *
+ * The grid only finds candidates: the caller still runs its exact test on
+ * every rectangle handed to it, so the results match a linear scan.
+ */
+class ObstacleGrid {
+
+#pragma mark Constants
+public:
+    /** Default cell width, one level tile */
+    static constexpr float DEFAULT_CELL_SIZE = 128;
+
+#pragma mark Internal References
+private:
+    /** Bottom left corner of the grid */
+    Vec2 _origin;
+    float _cellSize;
+    int _cols;
+    int _rows;
+    /** Start of each cell's bucket; has one extra entry at the end */
+    std::vector<int> _cellStart;
+    /** Rectangle ids of all buckets, cell after cell */
+    std::vector<int> _cellItems;
+    /** Bounds of the rectangles of all buckets, in the order of _cellItems */
+    std::vector<float> _bucketMinX;
+    std::vector<float> _bucketMinY;
+    std::vector<float> _bucketMaxX;
+    std::vector<float> _bucketMaxY;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Builds the grid over the given rectangles.
+     *
+     * The grid covers the union of the rectangles, so nothing outside it can
+     * be hit.
+     *
+     * @param minX      Left edge of every rectangle, as it should be tested
+     * @param minY      Bottom edge of every rectangle
+     * @param maxX      Right edge of every rectangle
+     * @param maxY      Top edge of every rectangle
+     * @param cellSize  Width and height of one cell
+     */
+    ObstacleGrid(const std::vector<float>& minX, const std::vector<float>& minY,
+                 const std::vector<float>& maxX, const std::vector<float>& maxY, float cellSize = DEFAULT_CELL_SIZE) {
+        _cellSize = cellSize > 0 ? cellSize : DEFAULT_CELL_SIZE;
+        _cols = 0;
+        _rows = 0;
+        int n = (int)minX.size();
+        if (n == 0) {
+            _cellStart.assign(1, 0);
+            return;
+        }
+
+        float left = *std::min_element(minX.begin(), minX.end());
+        float bottom = *std::min_element(minY.begin(), minY.end());
+        float right = *std::max_element(maxX.begin(), maxX.end());
+        float top = *std::max_element(maxY.begin(), maxY.end());
+        _origin = Vec2(left, bottom);
+        _cols = std::max(1, (int)std::ceil((right - left) / _cellSize));
+        _rows = std::max(1, (int)std::ceil((top - bottom) / _cellSize));
+
+        // count the rectangles of every cell, then fill the buckets
+        _cellStart.assign(_cols * _rows + 1, 0);
+        for (int i = 0; i < n; i++) {
+            forEachCell(minX[i], minY[i], maxX[i], maxY[i], [this](int cell) { _cellStart[cell + 1] += 1; });
+        }
+        for (int c = 0; c < _cols * _rows; c++) {
+            _cellStart[c + 1] += _cellStart[c];
+        }
+        _cellItems.resize(_cellStart.back());
+        std::vector<int> fill(_cellStart.begin(), _cellStart.end() - 1);
+        for (int i = 0; i < n; i++) {
+            forEachCell(minX[i], minY[i], maxX[i], maxY[i], [this, &fill, i](int cell) { _cellItems[fill[cell]++] = i; });
+        }
+        for (int item : _cellItems) {
+            _bucketMinX.push_back(minX[item]);
+            _bucketMinY.push_back(minY[item]);
+            _bucketMaxX.push_back(maxX[item]);
+            _bucketMaxY.push_back(maxY[item]);
+        }
+    }
+
+#pragma mark Queries
+public:
+    /**
+     * Runs `test` on the rectangles of the cell containing `point`.
+     *
+     * @return true as soon as `test` returns true for one of them
+     */
+    template <typename Test>
+    bool anyAt(const Vec2& point, Test test) const {
+        int col = (int)std::floor((point.x - _origin.x) / _cellSize);
+        int row = (int)std::floor((point.y - _origin.y) / _cellSize);
+        // points on the far edge of the grid still belong to the last cell
+        if (col == _cols && point.x == _origin.x + _cols * _cellSize) col -= 1;
+        if (row == _rows && point.y == _origin.y + _rows * _cellSize) row -= 1;
+        if (col < 0 || row < 0 || col >= _cols || row >= _rows) {
+            return false;
+        }
+        int cell = row * _cols + col;
+        for (int k = _cellStart[cell]; k < _cellStart[cell + 1]; k++) {
+            if (test(_cellItems[k])) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Runs `test` on the bucket of every cell crossed by the segment.
+     *
+     * The cells are walked in order from `a` to `b`. The test is called as
+     * `test(minX, minY, maxX, maxY, count)` with the bounds of the bucket's
+     * rectangles.
+     *
+     * @return true as soon as `test` returns true for one of them
+     */
+    template <typename Test>
+    bool anyOnSegment(const Vec2& a, const Vec2& b, Test test) const {
+        return GridWalk::walk(_origin, _cellSize, _cols, _rows, a, b, [this, &test](int cell, bool) {
+            return testCell(cell, test);
+        });
+    }
+
+#pragma mark Statistics
+public:
+    /** Returns the number of cells */
+    int cellCount() const {
+        return _cols * _rows;
+    }
+
+    /** Returns the average number of rectangles per cell */
+    float averageBucket() const {
+        return _cols * _rows > 0 ? (float)_cellItems.size() / (_cols * _rows) : 0;
+    }
+
+#pragma mark Helpers
+private:
+    /** Calls `f` on every cell the rectangle overlaps */
+    template <typename F>
+    void forEachCell(float minX, float minY, float maxX, float maxY, F f) const {
+        int c0 = clampCol((int)std::floor((minX - _origin.x) / _cellSize));
+        int c1 = clampCol((int)std::floor((maxX - _origin.x) / _cellSize));
+        int r0 = clampRow((int)std::floor((minY - _origin.y) / _cellSize));
+        int r1 = clampRow((int)std::floor((maxY - _origin.y) / _cellSize));
+        for (int row = r0; row <= r1; row++) {
+            for (int col = c0; col <= c1; col++) {
+                f(row * _cols + col);
+            }
+        }
+    }
+
+    template <typename Test>
+    bool testCell(int cell, Test& test) const {
+        int start = _cellStart[cell];
+        int count = _cellStart[cell + 1] - start;
+        return count > 0 && test(_bucketMinX.data() + start, _bucketMinY.data() + start,
+                                 _bucketMaxX.data() + start, _bucketMaxY.data() + start, count);
+    }
+
+    int clampCol(int col) const {
+        return std::min(std::max(col, 0), _cols - 1);
+    }
+
+    int clampRow(int row) const {
+        return std::min(std::max(row, 0), _rows - 1);
+    }
+};
+
+#endif /* __OBSTACLE_GRID_H__ */
@@ -0,0 +1,194 @@
+//
+//  OccupancyGrid.h
+//  Tilemap
+//
+//  Packed bitmap of the cells covered by obstacles.
+//
+
+#ifndef __OCCUPANCY_GRID_H__
+#define __OCCUPANCY_GRID_H__
+
+#include <cugl/cugl.h>
+#include "GridWalk.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+using namespace cugl;
+
+/**
+ * The obstacle layer rasterised into two packed bit planes.
+ *
+ *  - A cell is *touched* if it overlaps an obstacle grown by the margin.
+ *  - A cell is *solid* if it lies entirely inside an obstacle itself.
+ *
+ * A point or segment that only meets untouched cells is clear, and one that
+ * meets a solid cell is blocked. Answering takes one bit per cell on the
+ * segment, no matter how many obstacles there are. Only queries that pass
+ * through touched but not solid cells, along the obstacle borders, are left
+ * undecided for the exact test.
+ */
+class OccupancyGrid {
+
+#pragma mark Constants
+public:
+    /** Default width of a cell */
+    static constexpr float DEFAULT_RESOLUTION = 16;
+
+    /** Answer of a query */
+    enum class Result {
+        /** No obstacle is hit */
+        CLEAR,
+        /** An obstacle is certainly hit */
+        BLOCKED,
+        /** The query passes close to an obstacle; run the exact test */
+        UNSURE
+    };
+
+#pragma mark Internal References
+private:
+    /** Bottom left corner of the grid */
+    Vec2 _origin;
+    float _cellSize;
+    int _cols;
+    int _rows;
+    /** 64 bit words per row */
+    int _stride;
+    std::vector<uint64_t> _touched;
+    std::vector<uint64_t> _solid;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Rasterises the obstacles.
+     *
+     * The grid covers the union of the grown obstacles, so nothing outside
+     * it can be hit.
+     *
+     * @param minX      Left edge of every obstacle grown by the margin
+     * @param minY      Bottom edge of every grown obstacle
+     * @param maxX      Right edge of every grown obstacle
+     * @param maxY      Top edge of every grown obstacle
+     * @param margin    How much the obstacles were grown by
+     * @param cellSize  Width and height of one cell
+     */
+    OccupancyGrid(const std::vector<float>& minX, const std::vector<float>& minY,
+                  const std::vector<float>& maxX, const std::vector<float>& maxY,
+                  float margin, float cellSize = DEFAULT_RESOLUTION) {
+        _cellSize = cellSize > 0 ? cellSize : DEFAULT_RESOLUTION;
+        _cols = 0;
+        _rows = 0;
+        _stride = 0;
+        int n = (int)minX.size();
+        if (n == 0) {
+            return;
+        }
+
+        float left = *std::min_element(minX.begin(), minX.end());
+        float bottom = *std::min_element(minY.begin(), minY.end());
+        float right = *std::max_element(maxX.begin(), maxX.end());
+        float top = *std::max_element(maxY.begin(), maxY.end());
+        _origin = Vec2(left, bottom);
+        _cols = std::max(1, (int)std::ceil((right - left) / _cellSize));
+        _rows = std::max(1, (int)std::ceil((top - bottom) / _cellSize));
+        _stride = (_cols + 63) / 64;
+        _touched.assign((size_t)_stride * _rows, 0);
+        _solid.assign((size_t)_stride * _rows, 0);
+
+        for (int i = 0; i < n; i++) {
+            // every cell the grown obstacle overlaps, edges included
+            int c0 = colOf(minX[i]), c1 = colOf(maxX[i]);
+            int r0 = rowOf(minY[i]), r1 = rowOf(maxY[i]);
+            fill(_touched, c0, r0, c1, r1);
+
+            // only the cells that fit inside the obstacle itself
+            float x0 = minX[i] + margin, y0 = minY[i] + margin;
+            float x1 = maxX[i] - margin, y1 = maxY[i] - margin;
+            int s0 = (int)std::ceil((x0 - _origin.x) / _cellSize);
+            int s1 = (int)std::floor((x1 - _origin.x) / _cellSize) - 1;
+            int t0 = (int)std::ceil((y0 - _origin.y) / _cellSize);
+            int t1 = (int)std::floor((y1 - _origin.y) / _cellSize) - 1;
+            fill(_solid, std::max(s0, 0), std::max(t0, 0), std::min(s1, _cols - 1), std::min(t1, _rows - 1));
+        }
+    }
+
+#pragma mark Queries
+public:
+    /** Classifies a point against the grown obstacles */
+    Result testPoint(const Vec2& point) const {
+        float fx = (point.x - _origin.x) / _cellSize;
+        float fy = (point.y - _origin.y) / _cellSize;
+        if (_cols == 0 || fx < 0 || fy < 0 || fx > _cols || fy > _rows) {
+            return Result::CLEAR;
+        }
+        int cell = colOf(point.x) + rowOf(point.y) * _cols;
+        if (get(_solid, cell)) {
+            return Result::BLOCKED;
+        }
+        return get(_touched, cell) ? Result::UNSURE : Result::CLEAR;
+    }
+
+    /**
+     * Classifies a segment with the test of ItemView::containsLine.
+     *
+     * The segment is walked cell by cell. A solid cell on its path blocks it
+     * at once; touched cells only make the answer unsure.
+     */
+    Result testSegment(const Vec2& a, const Vec2& b) const {
+        bool unsure = false;
+        bool blocked = GridWalk::walk(_origin, _cellSize, _cols, _rows, a, b, [this, &unsure](int cell, bool onPath) {
+            if (!get(_touched, cell)) {
+                return false;
+            }
+            if (onPath && get(_solid, cell)) {
+                return true;
+            }
+            unsure = true;
+            return false;
+        });
+        if (blocked) {
+            return Result::BLOCKED;
+        }
+        return unsure ? Result::UNSURE : Result::CLEAR;
+    }
+
+#pragma mark Statistics
+public:
+    /** Returns the number of cells */
+    int cellCount() const {
+        return _cols * _rows;
+    }
+
+    /** Returns the memory taken by both bit planes in bytes */
+    size_t memoryBytes() const {
+        return (_touched.size() + _solid.size()) * sizeof(uint64_t);
+    }
+
+#pragma mark Helpers
+private:
+    int colOf(float x) const {
+        return std::min(std::max((int)std::floor((x - _origin.x) / _cellSize), 0), _cols - 1);
+    }
+
+    int rowOf(float y) const {
+        return std::min(std::max((int)std::floor((y - _origin.y) / _cellSize), 0), _rows - 1);
+    }
+
+    bool get(const std::vector<uint64_t>& plane, int cell) const {
+        int row = cell / _cols;
+        int col = cell - row * _cols;
+        return (plane[(size_t)row * _stride + col / 64] >> (col % 64)) & 1;
+    }
+
+    /** Sets the bits of the cells from (c0, r0) to (c1, r1), inclusive */
+    void fill(std::vector<uint64_t>& plane, int c0, int r0, int c1, int r1) {
+        for (int row = r0; row <= r1; row++) {
+            for (int col = c0; col <= c1; col++) {
+                plane[(size_t)row * _stride + col / 64] |= (uint64_t)1 << (col % 64);
+            }
+        }
+    }
+};
+
+#endif /* __OCCUPANCY_GRID_H__ */
@@ -0,0 +1,147 @@
+//
+//  RectMerger.h
+//  Tilemap
+//
+//  Merges touching obstacle rectangles into fewer, larger ones.
+//
+
+#ifndef __RECT_MERGER_H__
+#define __RECT_MERGER_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <algorithm>
+
+using namespace cugl;
+
+/**
+ * Replaces a list of rectangles with fewer rectangles covering the same area.
+ *
+ * Two rectangles are only merged when their union is itself a rectangle:
+ * they span the same rows and touch or overlap along x, or the same columns
+ * and touch or overlap along y. Rectangles inside another one are dropped.
+ * The passes repeat until nothing changes, so a wall drawn as a column of
+ * tiles ends up as one rectangle.
+ *
+ * Since the covered area does not change, growing every result by a margin
+ * covers the same area as growing the inputs, and a segment that crosses
+ * an input also crosses or ends inside a result. The obstacle queries give
+ * the same answers on either list. The merge is greedy, so an L shaped
+ * group still takes two rectangles, but it is not always the smallest
+ * possible cover.
+ */
+class RectMerger {
+
+#pragma mark Internal References
+private:
+    struct Box {
+        float minX, minY, maxX, maxY;
+    };
+
+#pragma mark Main Methods
+public:
+    /**
+     * Returns the merged rectangles.
+     *
+     * Edges are compared exactly, which suits the tile aligned obstacles of
+     * the level files.
+     *
+     * @param rects The rectangles to merge
+     */
+    static std::vector<Rect> merge(const std::vector<Rect>& rects) {
+        std::vector<Box> boxes;
+        boxes.reserve(rects.size());
+        for (const Rect& r : rects) {
+            boxes.push_back({r.getMinX(), r.getMinY(), r.getMaxX(), r.getMaxY()});
+        }
+
+        bool changed = true;
+        while (changed) {
+            changed = mergeRows(boxes);
+            // merging columns is merging the rows of the transposed boxes
+            transpose(boxes);
+            changed = mergeRows(boxes) || changed;
+            transpose(boxes);
+            changed = dropContained(boxes) || changed;
+        }
+
+        std::vector<Rect> result;
+        result.reserve(boxes.size());
+        for (const Box& b : boxes) {
+            result.push_back(Rect(b.minX, b.minY, b.maxX - b.minX, b.maxY - b.minY));
+        }
+        return result;
+    }
+
+#pragma mark Helpers
+private:
+    /**
+     * Merges the boxes that span the same rows and touch along x.
+     *
+     * @return true if any boxes were merged
+     */
+    static bool mergeRows(std::vector<Box>& boxes) {
+        if (boxes.size() < 2) {
+            return false;
+        }
+        std::sort(boxes.begin(), boxes.end(), [](const Box& a, const Box& b) {
+            if (a.minY != b.minY) return a.minY < b.minY;
+            if (a.maxY != b.maxY) return a.maxY < b.maxY;
+            return a.minX < b.minX;
+        });
+        int write = 0;
+        for (int k = 1; k < boxes.size(); k++) {
+            Box& last = boxes[write];
+            const Box& next = boxes[k];
+            if (next.minY == last.minY && next.maxY == last.maxY && next.minX <= last.maxX) {
+                last.maxX = std::max(last.maxX, next.maxX);
+            }
+            else {
+                boxes[++write] = next;
+            }
+        }
+        bool merged = write + 1 < boxes.size();
+        boxes.resize(write + 1);
+        return merged;
+    }
+
+    /**
+     * Removes the boxes that lie inside another box.
+     *
+     * @return true if any boxes were removed
+     */
+    static bool dropContained(std::vector<Box>& boxes) {
+        std::vector<bool> inside(boxes.size(), false);
+        for (int i = 0; i < boxes.size(); i++) {
+            for (int j = 0; j < boxes.size(); j++) {
+                if (i == j || inside[j]) {
+                    continue;
+                }
+                const Box& a = boxes[i];
+                const Box& b = boxes[j];
+                if (b.minX <= a.minX && b.minY <= a.minY && b.maxX >= a.maxX && b.maxY >= a.maxY) {
+                    inside[i] = true;
+                    break;
+                }
+            }
+        }
+        int write = 0;
+        for (int i = 0; i < boxes.size(); i++) {
+            if (!inside[i]) {
+                boxes[write++] = boxes[i];
+            }
+        }
+        bool dropped = write < boxes.size();
+        boxes.resize(write);
+        return dropped;
+    }
+
+    static void transpose(std::vector<Box>& boxes) {
+        for (Box& b : boxes) {
+            std::swap(b.minX, b.minY);
+            std::swap(b.maxX, b.maxY);
+        }
+    }
+};
+
+#endif /* __RECT_MERGER_H__ */
@@ -13,6 +13,22 @@
 #define MAP_HEIGHT          "height"
 #define TILE_WIDTH          "tilewidth"
 #define TILE_HEIGHT         "tileheight"
+#define MAP_PROPERTIES      "properties"
+
+/** Boolean map property that switches the guards to the nav mesh */
+#define NAVMESH_PROPERTY    "navmesh"
+
+/** Float map property with the cell size of the obstacle bitmap, 0 to turn it off */
+#define OCCUPANCY_PROPERTY  "occupancy"
+
+/** Float map property with the cell size of the switch map, 0 to turn it off */
+#define SWITCHMAP_PROPERTY  "switchmap"
+
+/** Int map property with extra patrolling guards spawned per world, for stress testing */
+#define STRESS_PROPERTY     "stressguards"
+
+/** Level played instead of the chosen one when GUARD_STRESS is defined */
+#define STRESS_LEVEL        0
 
 /** Map specific fields */
 #define TILEMAP_FILED       "tilemap"
@@ -39,4 +55,10 @@
 /** Guard specific fields */
 #define GUARD_FIELD         "guard"
 
+/** Baked navigation graph fields */
+#define NAVGRAPH_SUFFIX     "-nav.json"
+#define NAVGRAPH_HASH       "obsHash"
+#define NAVGRAPH_FIRSTMOVE  "firstMove"
+#define NAVGRAPH_VISIBILITY "visibility"
+
 #endif /* LevelConstants_h */
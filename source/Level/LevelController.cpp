@@ -10,12 +10,34 @@
 
 #include <cugl/assets/CUJsonLoader.h>
 #include <string>
+#include <unordered_map>
 
 #pragma mark -
 #pragma mark Static Constructors
 
 int totalHeight = 0;
 
+/** Navigation data built for a level this session */
+struct NavCacheEntry {
+    /** The obstacle hash the data was built for */
+    unsigned int obsHash;
+    std::shared_ptr<NavGraph> graph;
+    std::shared_ptr<FirstMoveTable> firstMoves;
+    std::shared_ptr<NavVisibility> visibility;
+};
+
+/** Navigation data built this session, keyed by level file */
+static std::unordered_map<std::string, NavCacheEntry> navCache;
+
+/** FNV-1a, used to detect when a cached or baked graph no longer matches the level */
+static unsigned int hashCombine(unsigned int hash, int value) {
+    for (int i = 0; i < 4; i++) {
+        hash ^= (value >> (8 * i)) & 0xff;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 /**
 * Creates a new, empty level.
 */
@@ -28,6 +50,11 @@ LevelController::LevelController(void) : Asset()
     _shadows = std::make_shared<ItemSetController>();
     _exit = std::make_shared<ItemSetController>();
     _resources = std::make_shared<ItemSetController>();
+    _obsHash = 0;
+    _useNavMesh = false;
+    _occupancyResolution = OccupancyGrid::DEFAULT_RESOLUTION;
+    _switchResolution = SwitchMap::DEFAULT_RESOLUTION;
+    _stressGuards = 0;
 }
 
 /**
@@ -61,7 +88,29 @@ void LevelController::clearRootNode() {
  */
 bool LevelController::preload(const std::string& file) {
     std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(file);
-    return preload(reader->readJson());
+    _navKey = file;
+    if (!preload(reader->readJson())) {
+        return false;
+    }
+
+    // navigation data loaded or built earlier this session
+    auto cached = navCache.find(_navKey);
+    if (cached != navCache.end() && cached->second.obsHash == _obsHash) {
+        _navGraph = cached->second.graph;
+        _firstMoves = cached->second.firstMoves;
+        _visibility = cached->second.visibility;
+        return true;
+    }
+
+    // otherwise a baked graph next to the level file
+    size_t ext = file.rfind(".json");
+    if (ext != std::string::npos) {
+        std::shared_ptr<JsonReader> navReader = JsonReader::allocWithAsset(file.substr(0, ext) + NAVGRAPH_SUFFIX);
+        if (navReader != nullptr && loadNavGraph(navReader->readJson())) {
+            navCache[_navKey] = {_obsHash, _navGraph, _firstMoves, _visibility};
+        }
+    }
+    return true;
 }
 
 /**
@@ -92,6 +141,35 @@ bool LevelController:: preload(const std::shared_ptr<cugl::JsonValue>& json) {
 //    int totWidth = mapWidth *tileWidth;
     totalHeight = mapHeight *tileHeight;
     
+    _obsHash = 2166136261u;
+    _obsHash = hashCombine(_obsHash, mapWidth);
+    _obsHash = hashCombine(_obsHash, mapHeight);
+    _obsHash = hashCombine(_obsHash, tileWidth);
+    _obsHash = hashCombine(_obsHash, tileHeight);
+    
+    // map properties set in Tiled
+    _useNavMesh = false;
+    _occupancyResolution = OccupancyGrid::DEFAULT_RESOLUTION;
+    _switchResolution = SwitchMap::DEFAULT_RESOLUTION;
+    _stressGuards = 0;
+    auto properties = json->get(MAP_PROPERTIES);
+    if (properties != nullptr) {
+        for (int i = 0; i < properties->size(); i++) {
+            if (properties->get(i)->get("name")->asString() == NAVMESH_PROPERTY) {
+                _useNavMesh = properties->get(i)->get("value")->asBool();
+            }
+            else if (properties->get(i)->get("name")->asString() == OCCUPANCY_PROPERTY) {
+                _occupancyResolution = properties->get(i)->get("value")->asFloat();
+            }
+            else if (properties->get(i)->get("name")->asString() == SWITCHMAP_PROPERTY) {
+                _switchResolution = properties->get(i)->get("value")->asFloat();
+            }
+            else if (properties->get(i)->get("name")->asString() == STRESS_PROPERTY) {
+                _stressGuards = properties->get(i)->get("value")->asInt();
+            }
+        }
+    }
+    
     // Get each object in each layer
     for (int i = 0; i < json->get("layers")->size(); i++) {
         // Get the objects per layer
@@ -130,6 +208,10 @@ void LevelController::unload() {
         _wall->clearSet();
         _wall = nullptr;
     }
+    // the session cache keeps its own reference for the next load
+    _navGraph = nullptr;
+    _firstMoves = nullptr;
+    _visibility = nullptr;
 }
 
 
@@ -137,6 +219,9 @@ bool LevelController::loadObject(const std::string type, int totalHeight, const
     if (type == TILEMAP_FILED) {
         return loadTilemap(json);
     }
+    if (type == OBS_FIELD) {
+        hashObstacle(json);
+    }
     if (type == ITEM_FIELD || type == OBS_FIELD || type == DECO_FIELD || type == EXIT_FIELD || type == RESOURCE_FIELD || type == SHADOW_FIELD) {
         return loadItem(json, type);
     }
@@ -307,3 +392,90 @@ void LevelController::setTilemapTexture() {
     _exit->setTexture(_assets);
     _resources->setTexture(_assets);
 };
+
+#pragma mark -
+#pragma mark Navigation
+
+/**
+* Folds an obstacle object into the obstacle hash
+*/
+void LevelController::hashObstacle(const std::shared_ptr<JsonValue>& json) {
+    _obsHash = hashCombine(_obsHash, json->get("x")->asInt());
+    _obsHash = hashCombine(_obsHash, json->get("y")->asInt());
+    _obsHash = hashCombine(_obsHash, json->get("width")->asInt());
+    _obsHash = hashCombine(_obsHash, json->get("height")->asInt());
+    for (char c : json->get("type")->asString()) {
+        _obsHash = hashCombine(_obsHash, c);
+    }
+}
+
+/**
+* Loads a baked navigation graph, ignoring it if the obstacles have changed since it was baked
+*/
+bool LevelController::loadNavGraph(const std::shared_ptr<JsonValue>& json) {
+    if (json == nullptr || !json->has(NAVGRAPH_HASH)) {
+        return false;
+    }
+    if ((unsigned int)json->get(NAVGRAPH_HASH)->asLong() != _obsHash) {
+        CULog("Baked navigation graph for %s is out of date, rebuilding", _navKey.c_str());
+        return false;
+    }
+    _navGraph = NavGraph::alloc(json);
+    if (_navGraph != nullptr && json->has(NAVGRAPH_FIRSTMOVE)) {
+        _firstMoves = FirstMoveTable::alloc(json->get(NAVGRAPH_FIRSTMOVE), *_navGraph);
+    }
+    if (_navGraph != nullptr && json->has(NAVGRAPH_VISIBILITY)) {
+        _visibility = NavVisibility::alloc(json->get(NAVGRAPH_VISIBILITY), *_navGraph);
+    }
+    return _navGraph != nullptr;
+}
+
+void LevelController::setNavGraph(const std::shared_ptr<NavGraph>& graph) {
+    _navGraph = graph;
+    _firstMoves = nullptr;
+    _visibility = nullptr;
+    if (!_navKey.empty()) {
+        navCache[_navKey] = {_obsHash, graph, nullptr, nullptr};
+    }
+    bakeNav();
+}
+
+void LevelController::setFirstMoveTable(const std::shared_ptr<FirstMoveTable>& table) {
+    _firstMoves = table;
+    auto cached = navCache.find(_navKey);
+    if (cached != navCache.end() && cached->second.graph == _navGraph) {
+        cached->second.firstMoves = table;
+    }
+    bakeNav();
+}
+
+void LevelController::setNodeVisibility(const std::shared_ptr<NavVisibility>& matrix) {
+    _visibility = matrix;
+    auto cached = navCache.find(_navKey);
+    if (cached != navCache.end() && cached->second.graph == _navGraph) {
+        cached->second.visibility = matrix;
+    }
+    bakeNav();
+}
+
+void LevelController::bakeNav() {
+#ifdef NAVGRAPH_BAKE
+    // write the graph out so it can be shipped next to the level file
+    std::shared_ptr<JsonValue> json = _navGraph->toJson();
+    json->appendChild(NAVGRAPH_HASH, JsonValue::alloc((long)_obsHash));
+    if (_firstMoves != nullptr) {
+        json->appendChild(NAVGRAPH_FIRSTMOVE, _firstMoves->toJson());
+    }
+    if (_visibility != nullptr) {
+        json->appendChild(NAVGRAPH_VISIBILITY, _visibility->toJson());
+    }
+    std::string name = _navKey.substr(_navKey.find_last_of('/') + 1);
+    std::string path = Application::get()->getSaveDirectory() + name.substr(0, name.rfind(".json")) + NAVGRAPH_SUFFIX;
+    std::shared_ptr<JsonWriter> writer = JsonWriter::alloc(path);
+    if (writer != nullptr) {
+        writer->writeJson(json);
+        writer->close();
+        CULog("Baked navigation graph to %s", path.c_str());
+    }
+#endif
+}
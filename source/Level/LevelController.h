@@ -13,6 +13,10 @@
 #include <cugl/assets/CUAsset.h>
 #include <Tilemap/TilemapController.h>
 #include <ItemSet/ItemSetController.h>
+#include <Nav/NavGraph.h>
+#include <Nav/FirstMoveTable.h>
+#include <Nav/NavVisibility.h>
+#include "SwitchMap.h"
 
 using namespace cugl;
 
@@ -45,6 +49,25 @@ protected:
     std::vector<std::vector<cugl::Vec2>> _movingGuardsPos;
     std::vector<std::vector<int>> _staticGuardsPos;
 
+    /** Navigation graph of this level, nullptr until baked, cached or built */
+    std::shared_ptr<NavGraph> _navGraph;
+    /** First-move table of the graph, nullptr until baked, cached or built */
+    std::shared_ptr<FirstMoveTable> _firstMoves;
+    /** Node visibility matrix of the graph, nullptr until baked, cached or built */
+    std::shared_ptr<NavVisibility> _visibility;
+    /** Source file of this level, used as the navigation cache key */
+    std::string _navKey;
+    /** Hash of the map size and obstacle layer, guards against stale bakes */
+    unsigned int _obsHash;
+    /** Whether the guards of this level walk on a nav mesh instead of the lattice */
+    bool _useNavMesh;
+    /** Cell size of the obstacle bitmap, 0 if the level has none */
+    float _occupancyResolution;
+    /** Cell size of the switch map, 0 if the level has none */
+    float _switchResolution;
+    /** Extra patrolling guards spawned per world, 0 in normal levels */
+    int _stressGuards;
+
 
 #pragma mark Internal Helper
     /**
@@ -64,6 +87,13 @@ protected:
     bool load(const std::shared_ptr<JsonValue>& json);
     bool loadCharacter(const std::shared_ptr<JsonValue>& json);
     bool loadGuard(const std::shared_ptr<JsonValue>& json);
+    bool loadNavGraph(const std::shared_ptr<JsonValue>& json);
+
+    /** Writes the navigation data to the save directory when NAVGRAPH_BAKE is defined */
+    void bakeNav();
+
+    /** Folds an obstacle object into _obsHash */
+    void hashObstacle(const std::shared_ptr<JsonValue>& json);
 
     /**
      * Clears the root scene graph node for this level
@@ -113,6 +143,92 @@ public:
     std::shared_ptr<ItemSetController> getExit() {return _exit;};
     std::shared_ptr<ItemSetController> getResources() {return _resources->copy();};
 
+#pragma mark Navigation
+    /**
+     * Returns the navigation graph of this level.
+     *
+     * The graph comes from the baked `-nav.json` file next to the level, or
+     * from the graph built the first time this level was loaded. Returns
+     * nullptr if neither exists, in which case the caller should build the
+     * graph and hand it back with `setNavGraph`.
+     */
+    std::shared_ptr<NavGraph> getNavGraph() {return _navGraph;};
+
+    /**
+     * Sets the navigation graph of this level and caches it for later loads.
+     *
+     * If NAVGRAPH_BAKE is defined, the graph is also written to the save
+     * directory so that it can be copied next to the level file.
+     *
+     * @param graph the navigation graph built for this level
+     */
+    void setNavGraph(const std::shared_ptr<NavGraph>& graph);
+
+    /**
+     * Returns the first-move table of the navigation graph.
+     *
+     * Like the graph, the table is baked next to the level or cached after
+     * the first load. Returns nullptr if neither exists; the caller may then
+     * build it and hand it back with `setFirstMoveTable`.
+     */
+    std::shared_ptr<FirstMoveTable> getFirstMoveTable() {return _firstMoves;};
+
+    /**
+     * Sets the first-move table of this level and caches it for later loads.
+     *
+     * @param table the table built for the navigation graph of this level
+     */
+    void setFirstMoveTable(const std::shared_ptr<FirstMoveTable>& table);
+
+    /**
+     * Returns the node visibility matrix of the navigation graph.
+     *
+     * Like the first-move table, the matrix is baked next to the level or
+     * cached after the first load. Returns nullptr if neither exists; the
+     * caller may then build it and hand it back with `setNodeVisibility`.
+     */
+    std::shared_ptr<NavVisibility> getNodeVisibility() {return _visibility;};
+
+    /**
+     * Sets the node visibility matrix of this level and caches it for later loads.
+     *
+     * @param matrix the matrix built for the navigation graph of this level
+     */
+    void setNodeVisibility(const std::shared_ptr<NavVisibility>& matrix);
+
+    /**
+     * Returns true if the guards of this level should path on a nav mesh.
+     *
+     * Set with the boolean map property NAVMESH_PROPERTY in Tiled. The mesh
+     * is built from the obstacle layer by the caller.
+     */
+    bool usesNavMesh() {return _useNavMesh;};
+
+    /**
+     * Returns the cell size of the obstacle bitmap used for line of sight.
+     *
+     * Set with the float map property OCCUPANCY_PROPERTY in Tiled, 0 turns
+     * the bitmap off.
+     */
+    float getOccupancyResolution() {return _occupancyResolution;};
+
+    /**
+     * Returns the cell size of the map of where the character can switch
+     * into this world.
+     *
+     * Set with the float map property SWITCHMAP_PROPERTY in Tiled, 0 turns
+     * the map off.
+     */
+    float getSwitchResolution() {return _switchResolution;};
+
+    /**
+     * Returns the number of extra patrolling guards spawned in each world.
+     *
+     * Set with the int map property STRESS_PROPERTY in Tiled, to measure
+     * the guard update with many guards. Normal levels have none.
+     */
+    int getStressGuards() {return _stressGuards;};
+
 #pragma mark Drawing Methods
 
     /**
@@ -0,0 +1,153 @@
+//
+//  SwitchMap.h
+//  Tilemap
+//
+//  Packed bitmap of where the character may switch into a world.
+//
+
+#ifndef __SWITCH_MAP_H__
+#define __SWITCH_MAP_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+using namespace cugl;
+
+/**
+ * Marks the places of a map where the character cannot land after a switch,
+ * because an obstacle of the world it switches into stands there.
+ *
+ * The map is cut into square cells, each with two bits:
+ *
+ *  - *blocked* if the whole cell lies inside an obstacle grown by the margin
+ *  - *edge* if the cell is only partly covered
+ *
+ * A cell with neither bit is safe. Only positions in edge cells, along the
+ * obstacle borders, are left to the exact test, so checking the character's
+ * position every frame is a bit read, and the UI can colour whole cells
+ * without any test at all.
+ */
+class SwitchMap {
+
+#pragma mark Constants
+public:
+    /** Default width of a cell */
+    static constexpr float DEFAULT_RESOLUTION = 16;
+
+    /** Answer of a query */
+    enum class Result {
+        /** The character can land here */
+        SAFE,
+        /** An obstacle stands here */
+        BLOCKED,
+        /** The position is near an obstacle border; run the exact test */
+        UNSURE
+    };
+
+#pragma mark Internal References
+private:
+    float _cellSize;
+    int _cols;
+    int _rows;
+    /** 64 bit words per row */
+    int _stride;
+    std::vector<uint64_t> _blocked;
+    std::vector<uint64_t> _edge;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Rasterises the obstacles of the world switched into.
+     *
+     * @param mapSize   The size of the map; the cells start at the origin
+     * @param obstacles The obstacles of that world, without the margin
+     * @param margin    How far the character has to stay from an obstacle
+     * @param cellSize  Width and height of one cell
+     */
+    SwitchMap(const Size& mapSize, const std::vector<Rect>& obstacles, float margin, float cellSize = DEFAULT_RESOLUTION) {
+        _cellSize = cellSize > 0 ? cellSize : DEFAULT_RESOLUTION;
+        _cols = std::max(1, (int)std::ceil(mapSize.width / _cellSize));
+        _rows = std::max(1, (int)std::ceil(mapSize.height / _cellSize));
+        _stride = (_cols + 63) / 64;
+        _blocked.assign((size_t)_stride * _rows, 0);
+        _edge.assign((size_t)_stride * _rows, 0);
+
+        for (const Rect& r : obstacles) {
+            float minX = r.getMinX() - margin, minY = r.getMinY() - margin;
+            float maxX = r.getMaxX() + margin, maxY = r.getMaxY() + margin;
+            // every cell the grown obstacle touches
+            fill(_edge, (int)std::floor(minX / _cellSize), (int)std::floor(minY / _cellSize),
+                 (int)std::floor(maxX / _cellSize), (int)std::floor(maxY / _cellSize));
+            // the cells it covers completely
+            fill(_blocked, (int)std::ceil(minX / _cellSize), (int)std::ceil(minY / _cellSize),
+                 (int)std::floor(maxX / _cellSize) - 1, (int)std::floor(maxY / _cellSize) - 1);
+        }
+        for (size_t w = 0; w < _edge.size(); w++) {
+            _edge[w] &= ~_blocked[w];
+        }
+    }
+
+#pragma mark Queries
+public:
+    /** Classifies a position; positions off the map are unsure */
+    Result test(const Vec2& pos) const {
+        int col = (int)std::floor(pos.x / _cellSize);
+        int row = (int)std::floor(pos.y / _cellSize);
+        if (col < 0 || row < 0 || col >= _cols || row >= _rows) {
+            return Result::UNSURE;
+        }
+        return cell(col, row);
+    }
+
+    /** Classifies a whole cell, for drawing the safe areas */
+    Result cell(int col, int row) const {
+        if (get(_blocked, col, row)) {
+            return Result::BLOCKED;
+        }
+        return get(_edge, col, row) ? Result::UNSURE : Result::SAFE;
+    }
+
+    /** Returns the width and height of a cell */
+    float getCellSize() const {
+        return _cellSize;
+    }
+
+    int getCols() const {
+        return _cols;
+    }
+
+    int getRows() const {
+        return _rows;
+    }
+
+#pragma mark Statistics
+public:
+    /** Returns the memory taken by both bit planes in bytes */
+    size_t memoryBytes() const {
+        return (_blocked.size() + _edge.size()) * sizeof(uint64_t);
+    }
+
+#pragma mark Helpers
+private:
+    bool get(const std::vector<uint64_t>& plane, int col, int row) const {
+        return (plane[(size_t)row * _stride + col / 64] >> (col % 64)) & 1;
+    }
+
+    /** Sets the bits of the cells from (c0, r0) to (c1, r1), clipped to the map */
+    void fill(std::vector<uint64_t>& plane, int c0, int r0, int c1, int r1) {
+        c0 = std::max(c0, 0);
+        r0 = std::max(r0, 0);
+        c1 = std::min(c1, _cols - 1);
+        r1 = std::min(r1, _rows - 1);
+        for (int row = r0; row <= r1; row++) {
+            for (int col = c0; col <= c1; col++) {
+                plane[(size_t)row * _stride + col / 64] |= (uint64_t)1 << (col % 64);
+            }
+        }
+    }
+};
+
+#endif /* __SWITCH_MAP_H__ */
@@ -0,0 +1,236 @@
+//
+//  AStarSearch.h
+//  Tilemap
+//
+//  A* shortest path search over a NavGraph.
+//
+
+#ifndef __ASTAR_SEARCH_H__
+#define __ASTAR_SEARCH_H__
+
+#include "NavGraph.h"
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+/**
+ * A* search with a binary-heap open list and a Euclidean heuristic.
+ *
+ * Edge costs are the Euclidean length of the edge, so the heuristic is
+ * consistent and the search can stop as soon as the goal is expanded.
+ * All scratch buffers are kept between queries; a generation stamp marks
+ * which entries belong to the current search so nothing needs clearing.
+ *
+ * An instance is not thread safe. Give every thread its own search.
+ */
+class AStarSearch {
+
+#pragma mark Internal References
+private:
+    /** An entry of the open list */
+    struct OpenNode {
+        float f;
+        float g;
+        int node;
+    };
+
+    /** Best known cost from the start to every node */
+    std::vector<float> _g;
+    /** Predecessor of every node on its best known path */
+    std::vector<int> _parent;
+    /** Generation in which _g/_parent of a node were last written */
+    std::vector<unsigned int> _seen;
+    /** Generation in which a node was last expanded */
+    std::vector<unsigned int> _closed;
+    /** The open list, kept as a binary heap */
+    std::vector<OpenNode> _open;
+    /** Region of every node, or nullptr if the search is not restricted */
+    const std::vector<int>* _region;
+    /** Region the current search is restricted to */
+    int _regionId;
+    /** Current search generation */
+    unsigned int _generation;
+    /** Number of nodes expanded by the last search */
+    int _expanded;
+
+#pragma mark Main Methods
+public:
+    AStarSearch() {
+        _region = nullptr;
+        _regionId = -1;
+        _generation = 0;
+        _expanded = 0;
+    }
+
+    /**
+     * Finds the shortest path from `start` to `goal`.
+     *
+     * @param graph     The graph to search
+     * @param start     The start node
+     * @param goal      The goal node
+     * @param out       Filled with the node ids from start to goal (inclusive)
+     * @param region    If not nullptr, the region of every node; the search
+     *                  then never leaves the region of `start`
+     *
+     * @return true if the goal is reachable; `out` is left empty otherwise
+     */
+    bool findPath(const NavGraph& graph, int start, int goal, std::vector<int>& out,
+                  const std::vector<int>* region = nullptr) {
+        out.clear();
+        _expanded = 0;
+        int n = graph.size();
+        if (start < 0 || goal < 0 || start >= n || goal >= n) {
+            return false;
+        }
+        prepare(n, region, start);
+
+        const Vec2& target = graph.position(goal);
+        _open.clear();
+        visit(start, 0, -1);
+        push(start, 0, graph.position(start).distance(target));
+
+        while (!_open.empty()) {
+            std::pop_heap(_open.begin(), _open.end(), compare);
+            OpenNode top = _open.back();
+            _open.pop_back();
+
+            int u = top.node;
+            if (_closed[u] == _generation || top.g > _g[u]) {
+                // stale entry left behind by a decrease-key
+                continue;
+            }
+            _closed[u] = _generation;
+            _expanded += 1;
+
+            if (u == goal) {
+                backtrack(goal, out);
+                return true;
+            }
+
+            const Vec2& pu = graph.position(u);
+            for (const int* it = graph.neighborsBegin(u); it != graph.neighborsEnd(u); ++it) {
+                int v = *it;
+                if (_closed[v] == _generation || !inRegion(v)) {
+                    continue;
+                }
+                const Vec2& pv = graph.position(v);
+                float g = top.g + pu.distance(pv);
+                if (_seen[v] != _generation || g < _g[v]) {
+                    visit(v, g, u);
+                    push(v, g, g + pv.distance(target));
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Computes the cost from `start` to every node of its region.
+     *
+     * This is a Dijkstra search that never leaves the region of `start`.
+     * Read the results with `cost` before the next search.
+     *
+     * @param graph     The graph to search
+     * @param start     The start node
+     * @param region    The region of every node
+     */
+    void searchRegion(const NavGraph& graph, int start, const std::vector<int>& region) {
+        _expanded = 0;
+        prepare(graph.size(), &region, start);
+        _open.clear();
+        visit(start, 0, -1);
+        push(start, 0, 0);
+
+        while (!_open.empty()) {
+            std::pop_heap(_open.begin(), _open.end(), compare);
+            OpenNode top = _open.back();
+            _open.pop_back();
+
+            int u = top.node;
+            if (_closed[u] == _generation || top.g > _g[u]) {
+                continue;
+            }
+            _closed[u] = _generation;
+            _expanded += 1;
+
+            const Vec2& pu = graph.position(u);
+            for (const int* it = graph.neighborsBegin(u); it != graph.neighborsEnd(u); ++it) {
+                int v = *it;
+                if (_closed[v] == _generation || !inRegion(v)) {
+                    continue;
+                }
+                float g = top.g + pu.distance(graph.position(v));
+                if (_seen[v] != _generation || g < _g[v]) {
+                    visit(v, g, u);
+                    push(v, g, g);
+                }
+            }
+        }
+    }
+
+    /** Returns the cost to the node found by the last `searchRegion`, or infinity */
+    float cost(int node) const {
+        if (node < 0 || node >= (int)_closed.size() || _closed[node] != _generation) {
+            return std::numeric_limits<float>::infinity();
+        }
+        return _g[node];
+    }
+
+    /** Returns the number of nodes expanded by the last search */
+    int getExpanded() const {
+        return _expanded;
+    }
+
+#pragma mark Helpers
+private:
+    /** Grows the scratch buffers and starts a new generation */
+    void prepare(int n, const std::vector<int>* region, int start) {
+        _region = region;
+        _regionId = region == nullptr ? -1 : (*region)[start];
+        if ((int)_g.size() < n) {
+            _g.resize(n);
+            _parent.resize(n);
+            _seen.resize(n, 0);
+            _closed.resize(n, 0);
+        }
+        _generation += 1;
+        if (_generation == 0) {
+            // the counter wrapped around, old stamps are no longer safe
+            std::fill(_seen.begin(), _seen.end(), 0);
+            std::fill(_closed.begin(), _closed.end(), 0);
+            _generation = 1;
+        }
+    }
+
+    bool inRegion(int node) const {
+        return _region == nullptr || (*_region)[node] == _regionId;
+    }
+
+    void visit(int node, float g, int parent) {
+        _g[node] = g;
+        _parent[node] = parent;
+        _seen[node] = _generation;
+    }
+
+    void push(int node, float g, float f) {
+        _open.push_back({f, g, node});
+        std::push_heap(_open.begin(), _open.end(), compare);
+    }
+
+    /** Heap order: lowest f first, ties broken towards the deeper node */
+    static bool compare(const OpenNode& a, const OpenNode& b) {
+        if (a.f != b.f) {
+            return a.f > b.f;
+        }
+        return a.g < b.g;
+    }
+
+    void backtrack(int goal, std::vector<int>& out) {
+        for (int curr = goal; curr != -1; curr = _parent[curr]) {
+            out.push_back(curr);
+        }
+        std::reverse(out.begin(), out.end());
+    }
+};
+
+#endif /* __ASTAR_SEARCH_H__ */
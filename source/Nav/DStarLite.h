@@ -0,0 +1,404 @@
+//
+//  DStarLite.h
+//  Tilemap
+//
+//  Incremental path search towards a moving target.
+//
+
+#ifndef __D_STAR_LITE_H__
+#define __D_STAR_LITE_H__
+
+#include "NavGraph.h"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * Incremental replanning for one guard chasing a moving target (Moving
+ * Target D* Lite).
+ *
+ * The search grows outwards from the guard, like A*, and keeps its search
+ * tree between queries:
+ *
+ *  - When the target moves, the distances from the guard stay valid. Only
+ *    the heuristic changes, which D* Lite absorbs with its key modifier, so
+ *    the search only grows until the new target is settled.
+ *  - When the guard moves to a node of its search tree, the part of the tree
+ *    below that node stays valid as it is. Its distances are all too long by
+ *    the same amount, which changes nothing about the tree, so the new root
+ *    simply keeps its old value. Only the nodes outside that subtree are
+ *    dropped and searched again. The search keeps a list of the nodes it
+ *    has reached, so this costs time in those nodes rather than in the
+ *    whole graph.
+ *
+ * One instance belongs to one guard and is not thread safe.
+ */
+class DStarLite {
+
+#pragma mark Internal References
+private:
+    /** Priority of a node in the open list, compared lexicographically */
+    struct Key {
+        float k1;
+        float k2;
+
+        bool operator<(const Key& other) const {
+            return k1 < other.k1 || (k1 == other.k1 && k2 < other.k2);
+        }
+    };
+
+    /** Distance from the root, plus the value of the root */
+    std::vector<float> _g;
+    /** One step lookahead of _g */
+    std::vector<float> _rhs;
+    /** Open list as a binary heap of nodes, with the position of every node in it */
+    std::vector<int> _heap;
+    std::vector<int> _heapIndex;
+    std::vector<Key> _key;
+    /** Scratch marks for finding the subtree of a new root: 0 unknown, 1 inside, 2 outside */
+    std::vector<uint8_t> _subtree;
+    std::vector<int> _chain;
+    /** Every node the search has queued since it last dropped it, and whether a node is listed */
+    std::vector<int> _reached;
+    std::vector<uint8_t> _listed;
+    /** The guard's node and the node being chased */
+    int _root;
+    int _target;
+    /** Sum of the heuristic drift since the search began */
+    float _km;
+    /** Graph the search state belongs to */
+    const NavGraph* _graph;
+    /** Number of nodes expanded by the last query */
+    int _expanded;
+
+#pragma mark Main Methods
+public:
+    DStarLite() {
+        _root = -1;
+        _target = -1;
+        _km = 0;
+        _graph = nullptr;
+        _expanded = 0;
+    }
+
+    /** Drops the search state, so the next query searches from scratch */
+    void reset() {
+        _graph = nullptr;
+    }
+
+    /**
+     * Finds a path from `start` to `target`, reusing the previous search.
+     *
+     * @param graph     The graph to search
+     * @param start     The guard's node
+     * @param target    The node to chase
+     * @param out       Filled with the node ids from start to target (inclusive)
+     *
+     * @return true if the target is reachable; `out` is left empty otherwise
+     */
+    bool findPath(const NavGraph& graph, int start, int target, std::vector<int>& out) {
+        out.clear();
+        _expanded = 0;
+        if (start < 0 || target < 0 || start >= graph.size() || target >= graph.size()) {
+            return false;
+        }
+        if (_graph != &graph || (int)_g.size() != graph.size() || !moveRoot(start)) {
+            initialize(graph, start, target);
+        }
+        if (target != _target) {
+            // keys already queued were computed towards the old target
+            _km += heuristic(_target, target);
+            _target = target;
+        }
+        computeShortestPath();
+        if (!(_g[target] < std::numeric_limits<float>::infinity())) {
+            return false;
+        }
+
+        // walk back from the target along the search tree
+        out.push_back(target);
+        for (int curr = target; curr != _root; ) {
+            curr = parent(curr);
+            if (curr == -1 || (int)out.size() > graph.size()) {
+                out.clear();
+                return false;
+            }
+            out.push_back(curr);
+        }
+        std::reverse(out.begin(), out.end());
+        return true;
+    }
+
+    /** Returns the number of nodes expanded by the last query */
+    int getExpanded() const {
+        return _expanded;
+    }
+
+#pragma mark Helpers
+private:
+    /** Starts a new search from `root` */
+    void initialize(const NavGraph& graph, int root, int target) {
+        _graph = &graph;
+        int n = graph.size();
+        _g.assign(n, std::numeric_limits<float>::infinity());
+        _rhs.assign(n, std::numeric_limits<float>::infinity());
+        _heapIndex.assign(n, -1);
+        _key.resize(n);
+        _subtree.assign(n, 0);
+        _listed.assign(n, 0);
+        _reached.clear();
+        _heap.clear();
+        _root = root;
+        _target = target;
+        _km = 0;
+        _rhs[root] = 0;
+        push(root, calculateKey(root));
+    }
+
+    /**
+     * Makes `node` the root of the search, keeping its subtree.
+     *
+     * @return false if `node` is not settled, in which case nothing is kept
+     */
+    bool moveRoot(int node) {
+        if (node == _root) {
+            return true;
+        }
+        if (!settled(node)) {
+            return false;
+        }
+
+        // only nodes the search reached can have a value; a settled one is in the
+        // subtree if its tree parents lead to the new root
+        _subtree[node] = 1;
+        for (int s : _reached) {
+            _chain.clear();
+            int curr = s;
+            while (_subtree[curr] == 0) {
+                _chain.push_back(curr);
+                curr = settled(curr) && curr != _root ? parent(curr) : -1;
+                if (curr == -1) {
+                    break;
+                }
+            }
+            uint8_t mark = curr == -1 ? 2 : _subtree[curr];
+            for (int c : _chain) {
+                _subtree[c] = mark;
+            }
+        }
+
+        // drop everything else; the new root keeps its value so the subtree stays consistent
+        _root = node;
+        for (int s : _reached) {
+            if (_subtree[s] == 2) {
+                _g[s] = std::numeric_limits<float>::infinity();
+                _rhs[s] = std::numeric_limits<float>::infinity();
+                if (_heapIndex[s] != -1) {
+                    remove(s);
+                }
+            }
+        }
+        // a dropped node can only get a value back from a neighbour in the subtree
+        for (int s : _reached) {
+            if (_subtree[s] == 2 && bordersSubtree(s)) {
+                updateRhs(s);
+            }
+        }
+
+        // forget the dropped nodes that stay without a value
+        int kept = 0;
+        for (int s : _reached) {
+            if (_subtree[s] == 1 || _heapIndex[s] != -1) {
+                _reached[kept++] = s;
+            }
+            else {
+                _listed[s] = 0;
+            }
+            _subtree[s] = 0;
+        }
+        _reached.resize(kept);
+        return true;
+    }
+
+    /** Returns true if the node's distance is final */
+    bool settled(int node) const {
+        return _g[node] < std::numeric_limits<float>::infinity() && _g[node] == _rhs[node] && _heapIndex[node] == -1;
+    }
+
+    /** Returns true if a neighbour of the node is in the subtree of the new root */
+    bool bordersSubtree(int node) const {
+        for (const int* it = _graph->neighborsBegin(node); it != _graph->neighborsEnd(node); ++it) {
+            if (_subtree[*it] == 1) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Returns the neighbour the node's distance comes from, -1 if it has none */
+    int parent(int node) const {
+        int best = -1;
+        float bestCost = std::numeric_limits<float>::infinity();
+        for (const int* it = _graph->neighborsBegin(node); it != _graph->neighborsEnd(node); ++it) {
+            float c = cost(*it, node) + _g[*it];
+            if (c < bestCost) {
+                bestCost = c;
+                best = *it;
+            }
+        }
+        // allow for rounding in the summed edge lengths
+        return best != -1 && bestCost <= _g[node] + std::fabs(_g[node]) * 1e-5f ? best : -1;
+    }
+
+    /** Returns the cost of the edge between two neighbours */
+    float cost(int u, int v) const {
+        return _graph->position(u).distance(_graph->position(v));
+    }
+
+    float heuristic(int a, int b) const {
+        return _graph->position(a).distance(_graph->position(b));
+    }
+
+    Key calculateKey(int node) const {
+        float m = std::min(_g[node], _rhs[node]);
+        return {m + heuristic(node, _target) + _km, m};
+    }
+
+    /** Recomputes the lookahead of a node and requeues it if it is inconsistent */
+    void updateRhs(int node) {
+        if (node == _root) {
+            return;
+        }
+        float best = std::numeric_limits<float>::infinity();
+        for (const int* it = _graph->neighborsBegin(node); it != _graph->neighborsEnd(node); ++it) {
+            best = std::min(best, cost(*it, node) + _g[*it]);
+        }
+        _rhs[node] = best;
+        updateVertex(node);
+    }
+
+    void updateVertex(int node) {
+        bool queued = _heapIndex[node] != -1;
+        if (_g[node] != _rhs[node]) {
+            if (queued) {
+                update(node, calculateKey(node));
+            }
+            else {
+                push(node, calculateKey(node));
+            }
+        }
+        else if (queued) {
+            remove(node);
+        }
+    }
+
+    /** Settles nodes until the target is consistent and nothing cheaper is queued */
+    void computeShortestPath() {
+        while (!_heap.empty() && (_key[_heap[0]] < calculateKey(_target) || _rhs[_target] != _g[_target])) {
+            int u = _heap[0];
+            Key fresh = calculateKey(u);
+            if (_key[u] < fresh) {
+                // the key was computed towards an older target
+                update(u, fresh);
+                continue;
+            }
+            _expanded += 1;
+            if (_g[u] > _rhs[u]) {
+                _g[u] = _rhs[u];
+                remove(u);
+                for (const int* it = _graph->neighborsBegin(u); it != _graph->neighborsEnd(u); ++it) {
+                    float c = cost(u, *it) + _g[u];
+                    if (*it != _root && c < _rhs[*it]) {
+                        _rhs[*it] = c;
+                        updateVertex(*it);
+                    }
+                }
+            }
+            else {
+                _g[u] = std::numeric_limits<float>::infinity();
+                updateRhs(u);
+                for (const int* it = _graph->neighborsBegin(u); it != _graph->neighborsEnd(u); ++it) {
+                    updateRhs(*it);
+                }
+            }
+        }
+    }
+
+#pragma mark Open List
+private:
+    void push(int node, const Key& key) {
+        if (!_listed[node]) {
+            _listed[node] = 1;
+            _reached.push_back(node);
+        }
+        _key[node] = key;
+        _heapIndex[node] = (int)_heap.size();
+        _heap.push_back(node);
+        siftUp(_heapIndex[node]);
+    }
+
+    void update(int node, const Key& key) {
+        bool lower = key < _key[node];
+        _key[node] = key;
+        if (lower) {
+            siftUp(_heapIndex[node]);
+        }
+        else {
+            siftDown(_heapIndex[node]);
+        }
+    }
+
+    void remove(int node) {
+        int i = _heapIndex[node];
+        int last = _heap.back();
+        _heap.pop_back();
+        _heapIndex[node] = -1;
+        if (last != node) {
+            _heap[i] = last;
+            _heapIndex[last] = i;
+            siftUp(i);
+            siftDown(_heapIndex[last]);
+        }
+    }
+
+    void siftUp(int i) {
+        while (i > 0) {
+            int parent = (i - 1) / 2;
+            if (!(_key[_heap[i]] < _key[_heap[parent]])) {
+                break;
+            }
+            swap(i, parent);
+            i = parent;
+        }
+    }
+
+    void siftDown(int i) {
+        int n = (int)_heap.size();
+        while (true) {
+            int smallest = i;
+            int l = 2 * i + 1;
+            int r = l + 1;
+            if (l < n && _key[_heap[l]] < _key[_heap[smallest]]) {
+                smallest = l;
+            }
+            if (r < n && _key[_heap[r]] < _key[_heap[smallest]]) {
+                smallest = r;
+            }
+            if (smallest == i) {
+                return;
+            }
+            swap(i, smallest);
+            i = smallest;
+        }
+    }
+
+    void swap(int i, int j) {
+        std::swap(_heap[i], _heap[j]);
+        _heapIndex[_heap[i]] = i;
+        _heapIndex[_heap[j]] = j;
+    }
+};
+
+#endif /* __D_STAR_LITE_H__ */
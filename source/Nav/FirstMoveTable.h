@@ -0,0 +1,375 @@
+//
+//  FirstMoveTable.h
+//  Tilemap
+//
+//  Precomputed first moves between every pair of nav nodes.
+//
+
+#ifndef __FIRST_MOVE_TABLE_H__
+#define __FIRST_MOVE_TABLE_H__
+
+#include "NavGraph.h"
+#include "FlowField.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+/**
+ * A compressed path database for one nav graph.
+ *
+ * For every source node the table stores the first move on a shortest path
+ * towards every target node, as an index into the source's neighbour list.
+ * A path is read by looking up the first move, stepping to that neighbour
+ * and repeating, so answering a query needs no search at all.
+ *
+ * Each row is run-length encoded over the target ids. On a lattice many
+ * targets have several equally short first moves, so the build keeps every
+ * optimal move per target and extends a run for as long as one move is
+ * optimal for all of its targets. Any optimal move leads along a shortest
+ * path, so mixing them still reaches the target. A lookup is a binary
+ * search in the row.
+ *
+ * The table costs one Dijkstra per node to build and O(V^2) scratch memory
+ * while building, so it is only meant for graphs up to MAX_NODES nodes.
+ */
+class FirstMoveTable {
+
+#pragma mark Constants
+public:
+    /** Largest graph a table is built for */
+    static constexpr int MAX_NODES = 4096;
+    /** Move stored for nodes without neighbours */
+    static constexpr uint8_t NO_MOVE = 0xFF;
+    /** Most neighbours a node may have */
+    static constexpr int MAX_DEGREE = 8;
+
+#pragma mark Internal References
+private:
+    /** Number of nodes of the graph the table was built for */
+    int _size;
+    /** Connected component of every node; only targets in the same component are stored */
+    std::vector<int> _component;
+    /** Start of each source's runs; has one extra entry at the end */
+    std::vector<int> _rowStart;
+    /** First target of every run */
+    std::vector<uint16_t> _runTarget;
+    /** Neighbour index taken by every target of the run */
+    std::vector<uint8_t> _runMove;
+    /** Time it took to build the table, 0 if it was loaded */
+    float _buildMillis;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Builds the table for the given graph.
+     *
+     * @param graph     The nav graph, see `supports`
+     * @param pool      Worker threads to share the searches between, or nullptr
+     */
+    FirstMoveTable(const NavGraph& graph, ThreadPool* pool = nullptr) {
+        auto start = std::chrono::steady_clock::now();
+        _size = graph.size();
+        int n = _size;
+        labelComponents(graph);
+
+        // optimal moves as bit masks, one row per source; each search fills one
+        // column. Targets in other components are never looked up, so any move will do
+        std::vector<uint8_t> dense((size_t)n * n, 0xFF);
+        auto fill = [&graph, &dense, n](FlowField& field, int target) {
+            field.update(graph, target);
+            for (int s = 0; s < n; s++) {
+                float best = field.distance(s);
+                if (s == target || !field.reachable(s)) {
+                    continue;
+                }
+                // allow for rounding in the summed path lengths
+                float slack = best * 1e-4f + 1e-3f;
+                uint8_t mask = 0;
+                int m = 0;
+                for (const int* it = graph.neighborsBegin(s); it != graph.neighborsEnd(s); ++it, ++m) {
+                    if (graph.position(s).distance(graph.position(*it)) + field.distance(*it) <= best + slack) {
+                        mask |= 1 << m;
+                    }
+                }
+                dense[(size_t)s * n + target] = mask;
+            }
+        };
+        if (pool == nullptr) {
+            FlowField field;
+            for (int t = 0; t < n; t++) {
+                fill(field, t);
+            }
+        }
+        else {
+            int workers = pool->size();
+            std::vector<FlowField> fields(workers);
+            for (int w = 0; w < workers; w++) {
+                pool->submit([&fill, &fields, w, workers, n](int worker) {
+                    for (int t = w; t < n; t += workers) {
+                        fill(fields[w], t);
+                    }
+                });
+            }
+            pool->wait();
+        }
+
+        // compress every row, extending each run while some move stays optimal;
+        // the source itself can take any move
+        _rowStart.assign(n + 1, 0);
+        for (int s = 0; s < n; s++) {
+            _rowStart[s] = (int)_runTarget.size();
+            const uint8_t* row = dense.data() + (size_t)s * n;
+            int runStart = -1;
+            uint8_t runMask = 0;
+            for (int t = 0; t < n; t++) {
+                if (t == s) {
+                    continue;
+                }
+                if (runStart != -1) {
+                    if ((runMask & row[t]) != 0) {
+                        runMask &= row[t];
+                        continue;
+                    }
+                    pushRun(s, runStart, runMask, graph.degree(s));
+                }
+                runStart = t;
+                runMask = row[t];
+            }
+            if (runStart != -1) {
+                pushRun(s, runStart, runMask, graph.degree(s));
+            }
+        }
+        _rowStart[n] = (int)_runTarget.size();
+        _buildMillis = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /** Returns true if a table can be built for the given graph */
+    static bool supports(const NavGraph& graph) {
+        if (graph.size() > MAX_NODES) {
+            return false;
+        }
+        for (int i = 0; i < graph.size(); i++) {
+            if (graph.degree(i) > MAX_DEGREE) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Returns a table read from a baked JSON section, or nullptr if it is malformed.
+     *
+     * The section has the format written by `toJson`:
+     * `{"rows": [...], "targets": [...], "moves": [...]}`
+     *
+     * @param json  The baked table
+     * @param graph The graph the table must belong to
+     */
+    static std::shared_ptr<FirstMoveTable> alloc(const std::shared_ptr<JsonValue>& json, const NavGraph& graph) {
+        if (json == nullptr || !json->has("rows") || !json->has("targets") || !json->has("moves")) {
+            return nullptr;
+        }
+        auto rows = json->get("rows");
+        auto targets = json->get("targets");
+        auto moves = json->get("moves");
+        if (rows->size() != graph.size() + 1 || targets->size() != moves->size()) {
+            return nullptr;
+        }
+
+        std::shared_ptr<FirstMoveTable> table(new FirstMoveTable());
+        table->_size = graph.size();
+        table->labelComponents(graph);
+        table->_rowStart.resize(rows->size());
+        for (int i = 0; i < rows->size(); i++) {
+            table->_rowStart[i] = rows->get(i)->asInt();
+        }
+        table->_runTarget.resize(targets->size());
+        table->_runMove.resize(moves->size());
+        for (int i = 0; i < targets->size(); i++) {
+            int target = targets->get(i)->asInt();
+            if (target < 0 || target >= graph.size()) {
+                return nullptr;
+            }
+            table->_runTarget[i] = (uint16_t)target;
+            table->_runMove[i] = (uint8_t)moves->get(i)->asInt();
+        }
+        if (table->_rowStart.front() != 0 || table->_rowStart.back() != table->_runTarget.size()) {
+            return nullptr;
+        }
+        for (int s = 0; s < graph.size(); s++) {
+            if (table->_rowStart[s] > table->_rowStart[s + 1] || table->_rowStart[s + 1] > table->_runTarget.size()) {
+                return nullptr;
+            }
+            for (int k = table->_rowStart[s]; k < table->_rowStart[s + 1]; k++) {
+                if (table->_runMove[k] != NO_MOVE && table->_runMove[k] >= graph.degree(s)) {
+                    return nullptr;
+                }
+                // a lookup needs the runs of a row to start at target 0 and to increase
+                bool first = k == table->_rowStart[s];
+                if (first ? table->_runTarget[k] != 0 : table->_runTarget[k] <= table->_runTarget[k - 1]) {
+                    return nullptr;
+                }
+            }
+        }
+        return table;
+    }
+
+    /** Returns this table as a JSON section that `alloc` can read back */
+    std::shared_ptr<JsonValue> toJson() const {
+        std::shared_ptr<JsonValue> json = JsonValue::allocObject();
+        std::shared_ptr<JsonValue> rows = JsonValue::allocArray();
+        for (int start : _rowStart) {
+            rows->appendChild(JsonValue::alloc((long)start));
+        }
+        std::shared_ptr<JsonValue> targets = JsonValue::allocArray();
+        std::shared_ptr<JsonValue> moves = JsonValue::allocArray();
+        for (int i = 0; i < _runTarget.size(); i++) {
+            targets->appendChild(JsonValue::alloc((long)_runTarget[i]));
+            moves->appendChild(JsonValue::alloc((long)_runMove[i]));
+        }
+        json->appendChild("rows", rows);
+        json->appendChild("targets", targets);
+        json->appendChild("moves", moves);
+        return json;
+    }
+
+#pragma mark Queries
+public:
+    /** Returns the number of nodes of the graph the table belongs to */
+    int size() const {
+        return _size;
+    }
+
+    /**
+     * Returns the neighbour to step to from `from` on the way to `to`.
+     *
+     * @return the neighbour node, or -1 if `to` is unreachable or equal to `from`
+     */
+    int firstMove(const NavGraph& graph, int from, int to) const {
+        if (from == to || _component[from] != _component[to]) {
+            return -1;
+        }
+        const uint16_t* begin = _runTarget.data() + _rowStart[from];
+        const uint16_t* end = _runTarget.data() + _rowStart[from + 1];
+        if (begin == end) {
+            return -1;
+        }
+        int run = (int)(std::upper_bound(begin, end, (uint16_t)to) - begin) - 1;
+        uint8_t move = _runMove[_rowStart[from] + run];
+        if (move == NO_MOVE) {
+            return -1;
+        }
+        return graph.neighborsBegin(from)[move];
+    }
+
+    /**
+     * Reads the path from `from` to `to` out of the table.
+     *
+     * @param graph The graph the table was built for
+     * @param from  The start node
+     * @param to    The goal node
+     * @param out   Filled with the node ids from `from` to `to` (inclusive)
+     *
+     * @return true if `to` is reachable; `out` is left empty otherwise
+     */
+    bool extractPath(const NavGraph& graph, int from, int to, std::vector<int>& out) const {
+        out.clear();
+        if (from < 0 || to < 0 || from >= _size || to >= _size) {
+            return false;
+        }
+        out.push_back(from);
+        for (int curr = from; curr != to; ) {
+            curr = firstMove(graph, curr, to);
+            if (curr == -1 || out.size() > _size) {
+                out.clear();
+                return false;
+            }
+            out.push_back(curr);
+        }
+        return true;
+    }
+
+#pragma mark Statistics
+public:
+    /** Returns the number of runs over all rows */
+    int runCount() const {
+        return (int)_runTarget.size();
+    }
+
+    /** Returns the memory taken by the compressed table in bytes */
+    size_t memoryBytes() const {
+        return (_rowStart.size() + _component.size()) * sizeof(int) + _runTarget.size() * (sizeof(uint16_t) + sizeof(uint8_t));
+    }
+
+    /** Returns the memory an uncompressed table would take in bytes */
+    size_t denseBytes() const {
+        return (size_t)_size * _size;
+    }
+
+    /**
+     * Logs the memory and lookup cost of this table.
+     *
+     * @param name  The name of the level world, for the log
+     */
+    void report(const std::string& name) const {
+        float runsPerRow = _size > 0 ? (float)runCount() / _size : 0;
+        CULog("First-move table %s: %d nodes, %d runs (%.1f per row, ~%.1f probes per step), %.1f KB vs %.1f KB dense, built in %.1f ms",
+              name.c_str(), _size, runCount(), runsPerRow, std::log2(std::max(runsPerRow, 1.0f)) + 1,
+              memoryBytes() / 1024.0f, denseBytes() / 1024.0f, _buildMillis);
+    }
+
+#pragma mark Helpers
+private:
+    /** Appends a run to the row of `source`, taking the lowest move that is optimal for all of it */
+    void pushRun(int source, int target, uint8_t mask, int degree) {
+        uint8_t move = NO_MOVE;
+        for (int m = 0; m < degree; m++) {
+            if (mask & (1 << m)) {
+                move = (uint8_t)m;
+                break;
+            }
+        }
+        // the first run of a row also covers the targets before it
+        bool first = _runTarget.size() == _rowStart[source];
+        _runTarget.push_back((uint16_t)(first ? 0 : target));
+        _runMove.push_back(move);
+    }
+
+    /** Labels the connected components of the graph */
+    void labelComponents(const NavGraph& graph) {
+        _component.assign(graph.size(), -1);
+        std::vector<int> stack;
+        int count = 0;
+        for (int i = 0; i < graph.size(); i++) {
+            if (_component[i] != -1) {
+                continue;
+            }
+            _component[i] = count;
+            stack.push_back(i);
+            while (!stack.empty()) {
+                int u = stack.back();
+                stack.pop_back();
+                for (const int* it = graph.neighborsBegin(u); it != graph.neighborsEnd(u); ++it) {
+                    if (_component[*it] == -1) {
+                        _component[*it] = count;
+                        stack.push_back(*it);
+                    }
+                }
+            }
+            count += 1;
+        }
+    }
+
+    /** Creates an empty table to be filled by `alloc` */
+    FirstMoveTable() {
+        _size = 0;
+        _buildMillis = 0;
+    }
+};
+
+#endif /* __FIRST_MOVE_TABLE_H__ */
@@ -0,0 +1,139 @@
+//
+//  FlowField.h
+//  Tilemap
+//
+//  Shortest-path tree towards a single target node.
+//
+
+#ifndef __FLOW_FIELD_H__
+#define __FLOW_FIELD_H__
+
+#include "NavGraph.h"
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+/**
+ * A flow field over a NavGraph towards one target node.
+ *
+ * One Dijkstra search outwards from the target gives every node its next
+ * hop on a shortest path to the target, so any number of guards can read
+ * their route from the same field. The field is only rebuilt when the
+ * target node changes.
+ */
+class FlowField {
+
+#pragma mark Internal References
+private:
+    /** An entry of the open list */
+    struct OpenNode {
+        float d;
+        int node;
+    };
+
+    /** Distance from every node to the target */
+    std::vector<float> _dist;
+    /** Next node on the way to the target, -1 at the target or if unreachable */
+    std::vector<int> _next;
+    /** Open list, kept as a binary heap */
+    std::vector<OpenNode> _open;
+    /** Target node of the current field, -1 if the field is empty */
+    int _target;
+
+#pragma mark Main Methods
+public:
+    FlowField() {
+        _target = -1;
+    }
+
+    /**
+     * Points the field at the given target node.
+     *
+     * Does nothing if the field already leads to that node.
+     *
+     * @param graph     The graph the field is built on
+     * @param target    The node every path should lead to
+     *
+     * @return true if the field was rebuilt
+     */
+    bool update(const NavGraph& graph, int target) {
+        if (target == _target && (int)_next.size() == graph.size()) {
+            return false;
+        }
+        build(graph, target);
+        return true;
+    }
+
+    /** Returns true if the target can be reached from the given node */
+    bool reachable(int node) const {
+        return node >= 0 && node < (int)_dist.size() && _dist[node] < std::numeric_limits<float>::infinity();
+    }
+
+    /** Returns the path length from the node to the target, infinity if unreachable */
+    float distance(int node) const {
+        return _dist[node];
+    }
+
+    /**
+     * Follows the field from `from` to the target.
+     *
+     * @param from  The node to start from
+     * @param out   Filled with the node ids from `from` to the target (inclusive)
+     *
+     * @return true if the target is reachable; `out` is left empty otherwise
+     */
+    bool extractPath(int from, std::vector<int>& out) const {
+        out.clear();
+        if (!reachable(from)) {
+            return false;
+        }
+        for (int curr = from; curr != -1; curr = _next[curr]) {
+            out.push_back(curr);
+        }
+        return true;
+    }
+
+#pragma mark Helpers
+private:
+    void build(const NavGraph& graph, int target) {
+        int n = graph.size();
+        _dist.assign(n, std::numeric_limits<float>::infinity());
+        _next.assign(n, -1);
+        _target = target;
+        if (target < 0 || target >= n) {
+            return;
+        }
+
+        _open.clear();
+        _dist[target] = 0;
+        _open.push_back({0, target});
+        while (!_open.empty()) {
+            std::pop_heap(_open.begin(), _open.end(), compare);
+            OpenNode top = _open.back();
+            _open.pop_back();
+
+            int u = top.node;
+            if (top.d > _dist[u]) {
+                continue;
+            }
+            const Vec2& pu = graph.position(u);
+            for (const int* it = graph.neighborsBegin(u); it != graph.neighborsEnd(u); ++it) {
+                int v = *it;
+                float d = top.d + pu.distance(graph.position(v));
+                if (d < _dist[v]) {
+                    _dist[v] = d;
+                    // the graph is undirected, so v reaches the target through u
+                    _next[v] = u;
+                    _open.push_back({d, v});
+                    std::push_heap(_open.begin(), _open.end(), compare);
+                }
+            }
+        }
+    }
+
+    static bool compare(const OpenNode& a, const OpenNode& b) {
+        return a.d > b.d;
+    }
+};
+
+#endif /* __FLOW_FIELD_H__ */
@@ -0,0 +1,243 @@
+//
+//  HierarchicalSearch.h
+//  Tilemap
+//
+//  Hierarchical path search (HPA*) over a NavGraph.
+//
+
+#ifndef __HIERARCHICAL_SEARCH_H__
+#define __HIERARCHICAL_SEARCH_H__
+
+#include "NavGraph.h"
+#include "NavHierarchy.h"
+#include "AStarSearch.h"
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+/**
+ * HPA* path search for large maps.
+ *
+ * The start and goal are linked to the transitions of their own cluster,
+ * A* runs over the abstract graph of the NavHierarchy, and each abstract
+ * step is then refined with an A* search that stays inside one cluster.
+ * Only the clusters on the route are ever searched, so the cost of a query
+ * grows with the length of the route rather than the area of the map.
+ *
+ * Paths are near optimal: they may take a slightly longer entrance than
+ * the flat search would. An instance is not thread safe.
+ */
+class HierarchicalSearch {
+
+#pragma mark Internal References
+private:
+    /** An entry of the abstract open list */
+    struct OpenNode {
+        float f;
+        float g;
+        int node;
+    };
+
+    /** Searches inside single clusters */
+    AStarSearch _local;
+    /** Best known cost of every abstract node, plus the virtual start and goal */
+    std::vector<float> _g;
+    std::vector<int> _parent;
+    std::vector<unsigned int> _seen;
+    std::vector<unsigned int> _closed;
+    /** Cost from every transition of the goal cluster to the goal */
+    std::vector<float> _goalCost;
+    std::vector<unsigned int> _goalSeen;
+    std::vector<OpenNode> _open;
+    /** Abstract route of the last search, as graph nodes */
+    std::vector<int> _route;
+    /** Scratch buffer for the refined pieces of the route */
+    std::vector<int> _piece;
+    unsigned int _generation;
+    /** Number of abstract nodes expanded by the last search */
+    int _expanded;
+
+#pragma mark Main Methods
+public:
+    HierarchicalSearch() {
+        _generation = 0;
+        _expanded = 0;
+    }
+
+    /**
+     * Finds a path from `start` to `goal`.
+     *
+     * @param graph     The graph to search
+     * @param hierarchy The abstraction of `graph`
+     * @param start     The start node
+     * @param goal      The goal node
+     * @param out       Filled with the node ids from start to goal (inclusive)
+     *
+     * @return true if the goal is reachable; `out` is left empty otherwise
+     */
+    bool findPath(const NavGraph& graph, const NavHierarchy& hierarchy, int start, int goal, std::vector<int>& out) {
+        out.clear();
+        _expanded = 0;
+        int n = graph.size();
+        if (start < 0 || goal < 0 || start >= n || goal >= n) {
+            return false;
+        }
+        const std::vector<int>& clusters = hierarchy.clusters();
+        if (clusters[start] == clusters[goal] && _local.findPath(graph, start, goal, out, &clusters)) {
+            return true;
+        }
+        if (!findRoute(graph, hierarchy, start, goal)) {
+            return false;
+        }
+
+        // refine every abstract step into graph nodes
+        out.push_back(start);
+        for (int k = 0; k + 1 < _route.size(); k++) {
+            int a = _route[k];
+            int b = _route[k + 1];
+            if (a == b) {
+                continue;
+            }
+            if (clusters[a] != clusters[b]) {
+                // an entrance edge
+                out.push_back(b);
+                continue;
+            }
+            if (!_local.findPath(graph, a, b, _piece, &clusters)) {
+                out.clear();
+                return false;
+            }
+            out.insert(out.end(), _piece.begin() + 1, _piece.end());
+        }
+        return true;
+    }
+
+    /** Returns the number of abstract nodes expanded by the last search */
+    int getExpanded() const {
+        return _expanded;
+    }
+
+#pragma mark Helpers
+private:
+    /**
+     * Runs A* over the abstract graph and stores the route in _route.
+     *
+     * Abstract node `size` is the virtual start and `size+1` the virtual goal.
+     */
+    bool findRoute(const NavGraph& graph, const NavHierarchy& hierarchy, int start, int goal) {
+        int a = hierarchy.size();
+        int virtualStart = a;
+        int virtualGoal = a + 1;
+        prepare(a + 2);
+        const std::vector<int>& clusters = hierarchy.clusters();
+        const Vec2& target = graph.position(goal);
+
+        // link the goal to the transitions of its cluster
+        _local.searchRegion(graph, goal, clusters);
+        int goalCluster = clusters[goal];
+        for (const int* it = hierarchy.clusterBegin(goalCluster); it != hierarchy.clusterEnd(goalCluster); ++it) {
+            float cost = _local.cost(hierarchy.transition(*it));
+            if (cost < std::numeric_limits<float>::infinity()) {
+                _goalCost[*it] = cost;
+                _goalSeen[*it] = _generation;
+            }
+        }
+
+        // and the start to the transitions of its own
+        _open.clear();
+        visit(virtualStart, 0, -1);
+        _closed[virtualStart] = _generation;
+        _local.searchRegion(graph, start, clusters);
+        int startCluster = clusters[start];
+        for (const int* it = hierarchy.clusterBegin(startCluster); it != hierarchy.clusterEnd(startCluster); ++it) {
+            float g = _local.cost(hierarchy.transition(*it));
+            if (g < std::numeric_limits<float>::infinity()) {
+                relax(*it, g, virtualStart, graph.position(hierarchy.transition(*it)).distance(target));
+            }
+        }
+
+        while (!_open.empty()) {
+            std::pop_heap(_open.begin(), _open.end(), compare);
+            OpenNode top = _open.back();
+            _open.pop_back();
+
+            int u = top.node;
+            if (_closed[u] == _generation || top.g > _g[u]) {
+                continue;
+            }
+            _closed[u] = _generation;
+            _expanded += 1;
+            if (u == virtualGoal) {
+                backtrack(hierarchy, start, goal);
+                return true;
+            }
+
+            if (_goalSeen[u] == _generation) {
+                relax(virtualGoal, top.g + _goalCost[u], u, 0);
+            }
+            for (int e = hierarchy.edgesBegin(u); e < hierarchy.edgesEnd(u); e++) {
+                int v = hierarchy.edgeTarget(e);
+                if (_closed[v] != _generation) {
+                    relax(v, top.g + hierarchy.edgeCost(e), u, graph.position(hierarchy.transition(v)).distance(target));
+                }
+            }
+        }
+        return false;
+    }
+
+    /** Grows the scratch buffers and starts a new generation */
+    void prepare(int n) {
+        if ((int)_g.size() < n) {
+            _g.resize(n);
+            _parent.resize(n);
+            _seen.resize(n, 0);
+            _closed.resize(n, 0);
+            _goalCost.resize(n);
+            _goalSeen.resize(n, 0);
+        }
+        _generation += 1;
+        if (_generation == 0) {
+            // the counter wrapped around, old stamps are no longer safe
+            std::fill(_seen.begin(), _seen.end(), 0);
+            std::fill(_closed.begin(), _closed.end(), 0);
+            std::fill(_goalSeen.begin(), _goalSeen.end(), 0);
+            _generation = 1;
+        }
+    }
+
+    void visit(int node, float g, int parent) {
+        _g[node] = g;
+        _parent[node] = parent;
+        _seen[node] = _generation;
+    }
+
+    void relax(int node, float g, int parent, float h) {
+        if (_seen[node] != _generation || g < _g[node]) {
+            visit(node, g, parent);
+            _open.push_back({g + h, g, node});
+            std::push_heap(_open.begin(), _open.end(), compare);
+        }
+    }
+
+    /** Heap order: lowest f first, ties broken towards the deeper node */
+    static bool compare(const OpenNode& a, const OpenNode& b) {
+        if (a.f != b.f) {
+            return a.f > b.f;
+        }
+        return a.g < b.g;
+    }
+
+    /** Turns the abstract path into the graph nodes start, transitions..., goal */
+    void backtrack(const NavHierarchy& hierarchy, int start, int goal) {
+        _route.clear();
+        _route.push_back(goal);
+        int a = hierarchy.size();
+        for (int curr = _parent[a + 1]; curr != a; curr = _parent[curr]) {
+            _route.push_back(hierarchy.transition(curr));
+        }
+        _route.push_back(start);
+        std::reverse(_route.begin(), _route.end());
+    }
+};
+
+#endif /* __HIERARCHICAL_SEARCH_H__ */
@@ -0,0 +1,210 @@
+//
+//  NavGraph.h
+//  Tilemap
+//
+//  Navigation graph shared by the guards of one world.
+//
+
+#ifndef __NAV_GRAPH_H__
+#define __NAV_GRAPH_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+using namespace cugl;
+
+/**
+ * An undirected navigation graph stored in compressed sparse row form.
+ *
+ * The neighbours of node `u` are `_neighbors[_offsets[u] .. _offsets[u+1])`,
+ * sorted in ascending order. Memory is O(V + E) and iterating the
+ * neighbours of a node is O(degree), instead of the O(V^2) adjacency
+ * matrix that used to be allocated per world.
+ */
+class NavGraph {
+
+#pragma mark Internal References
+private:
+    /** Position of every node, indexed by node id */
+    std::vector<Vec2> _positions;
+    /** Start of each node's neighbour list; has one extra entry at the end */
+    std::vector<int> _offsets;
+    /** Concatenated neighbour lists */
+    std::vector<int> _neighbors;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Creates the graph from the lattice produced by `TilemapController::getEdges`.
+     *
+     * Node ids must be 0 ... nodes.size()-1. Each edge is added in both
+     * directions; duplicate edges are ignored.
+     *
+     * @param nodes     The position of every node
+     * @param edges     The undirected edges between nodes
+     */
+    NavGraph(const std::unordered_map<int, Vec2>& nodes, const std::vector<std::pair<int,int>>& edges) {
+        std::vector<Vec2> positions(nodes.size());
+        for (auto& node : nodes) {
+            positions[node.first] = node.second;
+        }
+        init(positions, edges);
+    }
+
+    /**
+     * Creates the graph from a list of node positions and undirected edges.
+     *
+     * @param positions The position of every node, indexed by node id
+     * @param edges     The undirected edges between nodes
+     */
+    NavGraph(const std::vector<Vec2>& positions, const std::vector<std::pair<int,int>>& edges) {
+        init(positions, edges);
+    }
+
+    /**
+     * Returns a graph read from a baked JSON section, or nullptr if it is malformed.
+     *
+     * The section has the format written by `toJson`:
+     * `{"nodes": [x0, y0, x1, y1, ...], "edges": [u0, v0, u1, v1, ...]}`
+     *
+     * @param json  The baked navigation graph
+     */
+    static std::shared_ptr<NavGraph> alloc(const std::shared_ptr<JsonValue>& json) {
+        if (json == nullptr || !json->has("nodes") || !json->has("edges")) {
+            return nullptr;
+        }
+        auto nodes = json->get("nodes");
+        auto edges = json->get("edges");
+        if (nodes->size() % 2 != 0 || edges->size() % 2 != 0) {
+            return nullptr;
+        }
+
+        std::vector<Vec2> positions(nodes->size() / 2);
+        for (int i = 0; i < positions.size(); i++) {
+            positions[i] = Vec2(nodes->get(2 * i)->asFloat(), nodes->get(2 * i + 1)->asFloat());
+        }
+        int n = (int)positions.size();
+        std::vector<std::pair<int,int>> pairs(edges->size() / 2);
+        for (int i = 0; i < pairs.size(); i++) {
+            pairs[i] = std::make_pair(edges->get(2 * i)->asInt(), edges->get(2 * i + 1)->asInt());
+            if (pairs[i].first < 0 || pairs[i].second < 0 || pairs[i].first >= n || pairs[i].second >= n) {
+                return nullptr;
+            }
+        }
+        return std::make_shared<NavGraph>(positions, pairs);
+    }
+
+    /** Returns this graph as a JSON section that `alloc` can read back */
+    std::shared_ptr<JsonValue> toJson() const {
+        std::shared_ptr<JsonValue> json = JsonValue::allocObject();
+        std::shared_ptr<JsonValue> nodes = JsonValue::allocArray();
+        for (auto& pos : _positions) {
+            nodes->appendChild(JsonValue::alloc((double)pos.x));
+            nodes->appendChild(JsonValue::alloc((double)pos.y));
+        }
+        std::shared_ptr<JsonValue> edges = JsonValue::allocArray();
+        for (int u = 0; u < size(); u++) {
+            for (const int* it = neighborsBegin(u); it != neighborsEnd(u); ++it) {
+                if (u < *it) {
+                    edges->appendChild(JsonValue::alloc((long)u));
+                    edges->appendChild(JsonValue::alloc((long)*it));
+                }
+            }
+        }
+        json->appendChild("nodes", nodes);
+        json->appendChild("edges", edges);
+        return json;
+    }
+
+#pragma mark Graph Access
+public:
+    /** Returns the number of nodes */
+    int size() const {
+        return (int)_positions.size();
+    }
+
+    /** Returns the number of undirected edges */
+    int edgeCount() const {
+        return (int)_neighbors.size() / 2;
+    }
+
+    /** Returns the position of the given node */
+    const Vec2& position(int node) const {
+        return _positions[node];
+    }
+
+    /** Returns the number of neighbours of the given node */
+    int degree(int node) const {
+        return _offsets[node + 1] - _offsets[node];
+    }
+
+    /** Returns a pointer to the first neighbour of the given node */
+    const int* neighborsBegin(int node) const {
+        return _neighbors.data() + _offsets[node];
+    }
+
+    /** Returns a pointer one past the last neighbour of the given node */
+    const int* neighborsEnd(int node) const {
+        return _neighbors.data() + _offsets[node + 1];
+    }
+
+    /** Returns true if there is an edge between u and v */
+    bool hasEdge(int u, int v) const {
+        return std::binary_search(neighborsBegin(u), neighborsEnd(u), v);
+    }
+
+#pragma mark Helpers
+private:
+    /** Builds the compressed sparse row arrays */
+    void init(const std::vector<Vec2>& positions, const std::vector<std::pair<int,int>>& edges) {
+        int n = (int)positions.size();
+        _positions = positions;
+
+        // count the degree of every node, then prefix sum into offsets
+        _offsets.assign(n + 1, 0);
+        for (auto& e : edges) {
+            _offsets[e.first + 1] += 1;
+            _offsets[e.second + 1] += 1;
+        }
+        for (int i = 0; i < n; i++) {
+            _offsets[i + 1] += _offsets[i];
+        }
+
+        _neighbors.resize(_offsets[n]);
+        std::vector<int> fill(_offsets.begin(), _offsets.end() - 1);
+        for (auto& e : edges) {
+            _neighbors[fill[e.first]++] = e.second;
+            _neighbors[fill[e.second]++] = e.first;
+        }
+
+        // sort so that searches visit neighbours in the same order as the old matrix scan
+        for (int i = 0; i < n; i++) {
+            std::sort(_neighbors.begin() + _offsets[i], _neighbors.begin() + _offsets[i + 1]);
+        }
+        compact();
+    }
+
+    /** Removes duplicate edges from the (sorted) neighbour lists */
+    void compact() {
+        int n = size();
+        int write = 0;
+        int start = 0;
+        for (int i = 0; i < n; i++) {
+            int end = _offsets[i + 1];
+            _offsets[i] = write;
+            for (int k = start; k < end; k++) {
+                if (k == start || _neighbors[k] != _neighbors[k - 1]) {
+                    _neighbors[write++] = _neighbors[k];
+                }
+            }
+            start = end;
+        }
+        _offsets[n] = write;
+        _neighbors.resize(write);
+        _neighbors.shrink_to_fit();
+    }
+};
+
+#endif /* __NAV_GRAPH_H__ */
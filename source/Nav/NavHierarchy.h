@@ -0,0 +1,299 @@
+//
+//  NavHierarchy.h
+//  Tilemap
+//
+//  Cluster abstraction of a NavGraph for hierarchical path search.
+//
+
+#ifndef __NAV_HIERARCHY_H__
+#define __NAV_HIERARCHY_H__
+
+#include "NavGraph.h"
+#include "AStarSearch.h"
+#include <vector>
+#include <map>
+#include <tuple>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+/**
+ * The abstract graph used by HierarchicalSearch (HPA*).
+ *
+ * The nav graph is cut into square clusters of `clusterWidth` lattice steps.
+ * Wherever edges cross between two clusters, a few of them are picked as
+ * entrances and their end nodes become transitions. Transitions of the same
+ * cluster are joined by abstract edges that cost the shortest path between
+ * them inside the cluster; the entrance edges themselves join neighbouring
+ * clusters. Everything here is computed once when the level loads and is
+ * read only afterwards, so one hierarchy can be shared between searches.
+ */
+class NavHierarchy {
+
+#pragma mark Constants
+public:
+    /** Lattice steps along one side of a cluster */
+    static constexpr int CLUSTER_WIDTH = 10;
+    /** Graphs smaller than this are searched flat */
+    static constexpr int MIN_NODES = 2000;
+    /** Entrances at least this long get a transition at each end instead of one in the middle */
+    static constexpr int LONG_ENTRANCE = 6;
+
+#pragma mark Internal References
+private:
+    /** Cluster of every graph node */
+    std::vector<int> _cluster;
+    /** Abstract node of every graph node, -1 if it is not a transition */
+    std::vector<int> _abstractOf;
+    /** Graph node of every abstract node */
+    std::vector<int> _transitions;
+    /** Start of each cluster's transitions in _clusterNodes; has one extra entry */
+    std::vector<int> _clusterStart;
+    /** Abstract nodes sorted by cluster */
+    std::vector<int> _clusterNodes;
+    /** Start of each abstract node's edges; has one extra entry at the end */
+    std::vector<int> _offsets;
+    /** Target abstract node of every abstract edge */
+    std::vector<int> _targets;
+    /** Cost of every abstract edge */
+    std::vector<float> _costs;
+    int _clusterCount;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Builds the abstraction of the given graph.
+     *
+     * @param graph         The nav graph
+     * @param clusterWidth  The number of lattice steps along a cluster side
+     */
+    NavHierarchy(const NavGraph& graph, int clusterWidth = CLUSTER_WIDTH) {
+        assignClusters(graph, clusterWidth);
+
+        std::vector<std::tuple<int,int,float>> edges;
+        findEntrances(graph, edges);
+        connectClusters(graph, edges);
+
+        // abstract edges in compressed sparse row form
+        int a = (int)_transitions.size();
+        _offsets.assign(a + 1, 0);
+        for (auto& e : edges) {
+            _offsets[std::get<0>(e) + 1] += 1;
+        }
+        for (int i = 0; i < a; i++) {
+            _offsets[i + 1] += _offsets[i];
+        }
+        _targets.resize(edges.size());
+        _costs.resize(edges.size());
+        std::vector<int> fill(_offsets.begin(), _offsets.end() - 1);
+        for (auto& e : edges) {
+            int k = fill[std::get<0>(e)]++;
+            _targets[k] = std::get<1>(e);
+            _costs[k] = std::get<2>(e);
+        }
+    }
+
+#pragma mark Hierarchy Access
+public:
+    /** Returns the cluster of every graph node */
+    const std::vector<int>& clusters() const {
+        return _cluster;
+    }
+
+    /** Returns the cluster of the given graph node */
+    int cluster(int node) const {
+        return _cluster[node];
+    }
+
+    /** Returns the number of clusters */
+    int clusterCount() const {
+        return _clusterCount;
+    }
+
+    /** Returns the number of abstract nodes */
+    int size() const {
+        return (int)_transitions.size();
+    }
+
+    /** Returns the abstract node of the given graph node, -1 if it is not a transition */
+    int abstractOf(int node) const {
+        return _abstractOf[node];
+    }
+
+    /** Returns the graph node of the given abstract node */
+    int transition(int abstract) const {
+        return _transitions[abstract];
+    }
+
+    /** Returns a pointer to the first abstract node of the given cluster */
+    const int* clusterBegin(int cluster) const {
+        return _clusterNodes.data() + _clusterStart[cluster];
+    }
+
+    /** Returns a pointer one past the last abstract node of the given cluster */
+    const int* clusterEnd(int cluster) const {
+        return _clusterNodes.data() + _clusterStart[cluster + 1];
+    }
+
+    /** Returns the index of the first edge of the given abstract node */
+    int edgesBegin(int abstract) const {
+        return _offsets[abstract];
+    }
+
+    /** Returns the index one past the last edge of the given abstract node */
+    int edgesEnd(int abstract) const {
+        return _offsets[abstract + 1];
+    }
+
+    /** Returns the target abstract node of the given edge */
+    int edgeTarget(int edge) const {
+        return _targets[edge];
+    }
+
+    /** Returns the cost of the given edge */
+    float edgeCost(int edge) const {
+        return _costs[edge];
+    }
+
+#pragma mark Helpers
+private:
+    /** Puts every node in a square cluster according to its position */
+    void assignClusters(const NavGraph& graph, int clusterWidth) {
+        int n = graph.size();
+        _cluster.assign(n, 0);
+        _abstractOf.assign(n, -1);
+        _clusterCount = n > 0 ? 1 : 0;
+        if (n == 0) {
+            _clusterStart.assign(2, 0);
+            return;
+        }
+
+        Vec2 lo = graph.position(0);
+        Vec2 hi = graph.position(0);
+        for (int i = 0; i < n; i++) {
+            const Vec2& p = graph.position(i);
+            lo = Vec2(std::min(lo.x, p.x), std::min(lo.y, p.y));
+            hi = Vec2(std::max(hi.x, p.x), std::max(hi.y, p.y));
+        }
+
+        // the lattice step is the average edge length
+        float spacing = 0;
+        for (int u = 0; u < n; u++) {
+            for (const int* it = graph.neighborsBegin(u); it != graph.neighborsEnd(u); ++it) {
+                spacing += graph.position(u).distance(graph.position(*it));
+            }
+        }
+        if (graph.edgeCount() > 0) {
+            spacing /= 2 * graph.edgeCount();
+        }
+        else {
+            spacing = std::sqrt(std::max(hi.x - lo.x, 1.0f) * std::max(hi.y - lo.y, 1.0f) / n);
+        }
+        spacing = std::max(spacing, 1.0f);
+
+        // shift the borders half a step so that lattice nodes never sit on them
+        float extent = spacing * clusterWidth;
+        int cols = (int)((hi.x - lo.x + spacing / 2) / extent) + 1;
+        int rows = (int)((hi.y - lo.y + spacing / 2) / extent) + 1;
+        for (int i = 0; i < n; i++) {
+            const Vec2& p = graph.position(i);
+            int col = std::min((int)((p.x - lo.x + spacing / 2) / extent), cols - 1);
+            int row = std::min((int)((p.y - lo.y + spacing / 2) / extent), rows - 1);
+            _cluster[i] = row * cols + col;
+        }
+        _clusterCount = cols * rows;
+    }
+
+    /** Returns the abstract node of a graph node, making it a transition if needed */
+    int addTransition(int node) {
+        if (_abstractOf[node] == -1) {
+            _abstractOf[node] = (int)_transitions.size();
+            _transitions.push_back(node);
+        }
+        return _abstractOf[node];
+    }
+
+    /**
+     * Picks the entrances between every pair of neighbouring clusters.
+     *
+     * The edges crossing between two clusters are split into runs of
+     * adjacent edges. A short run gets one entrance in its middle and a long
+     * run one at each end.
+     */
+    void findEntrances(const NavGraph& graph, std::vector<std::tuple<int,int,float>>& edges) {
+        std::map<std::pair<int,int>, std::vector<std::pair<int,int>>> borders;
+        for (int u = 0; u < graph.size(); u++) {
+            for (const int* it = graph.neighborsBegin(u); it != graph.neighborsEnd(u); ++it) {
+                int v = *it;
+                if (_cluster[u] < _cluster[v]) {
+                    borders[std::make_pair(_cluster[u], _cluster[v])].push_back(std::make_pair(u, v));
+                }
+            }
+        }
+
+        for (auto& border : borders) {
+            auto& crossing = border.second;
+            std::sort(crossing.begin(), crossing.end(), [&graph](const std::pair<int,int>& a, const std::pair<int,int>& b) {
+                const Vec2& pa = graph.position(a.first);
+                const Vec2& pb = graph.position(b.first);
+                return pa.x != pb.x ? pa.x < pb.x : pa.y < pb.y;
+            });
+            int runStart = 0;
+            for (int k = 1; k <= crossing.size(); k++) {
+                bool runEnds = k == crossing.size()
+                    || !graph.hasEdge(crossing[k - 1].first, crossing[k].first)
+                    || !graph.hasEdge(crossing[k - 1].second, crossing[k].second);
+                if (!runEnds) {
+                    continue;
+                }
+                int length = k - runStart;
+                if (length >= LONG_ENTRANCE) {
+                    addEntrance(graph, crossing[runStart], edges);
+                    addEntrance(graph, crossing[k - 1], edges);
+                }
+                else {
+                    addEntrance(graph, crossing[runStart + length / 2], edges);
+                }
+                runStart = k;
+            }
+        }
+    }
+
+    void addEntrance(const NavGraph& graph, const std::pair<int,int>& edge, std::vector<std::tuple<int,int,float>>& edges) {
+        int a = addTransition(edge.first);
+        int b = addTransition(edge.second);
+        float cost = graph.position(edge.first).distance(graph.position(edge.second));
+        edges.push_back(std::make_tuple(a, b, cost));
+        edges.push_back(std::make_tuple(b, a, cost));
+    }
+
+    /** Joins the transitions of every cluster with their shortest path costs */
+    void connectClusters(const NavGraph& graph, std::vector<std::tuple<int,int,float>>& edges) {
+        _clusterStart.assign(_clusterCount + 1, 0);
+        for (int t : _transitions) {
+            _clusterStart[_cluster[t] + 1] += 1;
+        }
+        for (int c = 0; c < _clusterCount; c++) {
+            _clusterStart[c + 1] += _clusterStart[c];
+        }
+        _clusterNodes.resize(_transitions.size());
+        std::vector<int> fill(_clusterStart.begin(), _clusterStart.end() - 1);
+        for (int a = 0; a < _transitions.size(); a++) {
+            _clusterNodes[fill[_cluster[_transitions[a]]]++] = a;
+        }
+
+        AStarSearch search;
+        for (int a = 0; a < _transitions.size(); a++) {
+            int c = _cluster[_transitions[a]];
+            search.searchRegion(graph, _transitions[a], _cluster);
+            for (const int* it = clusterBegin(c); it != clusterEnd(c); ++it) {
+                float cost = search.cost(_transitions[*it]);
+                if (*it != a && cost < std::numeric_limits<float>::infinity()) {
+                    edges.push_back(std::make_tuple(a, *it, cost));
+                }
+            }
+        }
+    }
+};
+
+#endif /* __NAV_HIERARCHY_H__ */
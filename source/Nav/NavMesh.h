@@ -0,0 +1,540 @@
+//
+//  NavMesh.h
+//  Tilemap
+//
+//  Convex decomposition of the free space around the obstacles.
+//
+
+#ifndef __NAV_MESH_H__
+#define __NAV_MESH_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <set>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+using namespace cugl;
+
+/**
+ * A navigation mesh of the free space of one world.
+ *
+ * Every obstacle of the level is an axis aligned rectangle, so instead of
+ * triangulating, the free space is cut along the obstacle edges into a grid
+ * and the free grid cells are merged greedily into larger rectangles. Each
+ * rectangle is convex, so a guard can walk straight between any two points
+ * of it, and neighbouring rectangles share one straight portal. An open
+ * room becomes a handful of cells instead of hundreds of lattice nodes, and
+ * a gap between two obstacles is represented exactly, however narrow.
+ *
+ * A query runs A* over the cells and pulls the route through the portals
+ * with the funnel algorithm, so the result is the shortest path within the
+ * corridor and only turns at obstacle corners.
+ */
+class NavMesh {
+
+#pragma mark Constants
+public:
+    /** Extra distance kept from the inflated obstacles, so path corners never touch them */
+    static constexpr float CORNER_CLEARANCE = 1.0f;
+
+#pragma mark Internal References
+private:
+    /** One convex cell of the mesh */
+    struct Cell {
+        float minX, minY, maxX, maxY;
+    };
+
+    /** The shared edge between two cells */
+    struct Portal {
+        /** The cell on the other side */
+        int cell;
+        /** End points of the portal, lowest coordinate first */
+        Vec2 a;
+        Vec2 b;
+    };
+
+    /** An entry of the open list */
+    struct OpenNode {
+        float f;
+        float g;
+        int node;
+    };
+
+    std::vector<Cell> _cells;
+    /** Start of each cell's portals; has one extra entry at the end */
+    std::vector<int> _portalStart;
+    std::vector<Portal> _portals;
+    /** Borders of the grid the free space was cut into */
+    std::vector<float> _xs;
+    std::vector<float> _ys;
+    /** Cell covering every grid square, -1 for squares inside obstacles */
+    std::vector<int> _owner;
+
+    /** Search buffers */
+    std::vector<float> _g;
+    std::vector<int> _parent;
+    std::vector<Vec2> _entry;
+    std::vector<unsigned int> _seen;
+    std::vector<unsigned int> _closed;
+    std::vector<OpenNode> _open;
+    std::vector<int> _route;
+    std::vector<Vec2> _left;
+    std::vector<Vec2> _right;
+    unsigned int _generation;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Builds the mesh of the free space inside `bounds`.
+     *
+     * @param bounds    The area the guards may walk in
+     * @param obstacles The obstacle rectangles
+     * @param margin    The distance the guards keep from every obstacle
+     */
+    NavMesh(const Rect& bounds, const std::vector<Rect>& obstacles, float margin) {
+        _generation = 0;
+        float inflate = margin + CORNER_CLEARANCE;
+
+        // clip the inflated obstacles to the bounds
+        std::vector<Cell> blocked;
+        for (const Rect& rect : obstacles) {
+            Cell c = {
+                std::max(rect.getMinX() - inflate, bounds.getMinX()),
+                std::max(rect.getMinY() - inflate, bounds.getMinY()),
+                std::min(rect.getMaxX() + inflate, bounds.getMaxX()),
+                std::min(rect.getMaxY() + inflate, bounds.getMaxY())
+            };
+            if (c.minX < c.maxX && c.minY < c.maxY) {
+                blocked.push_back(c);
+            }
+        }
+
+        // cut the bounds along every obstacle edge
+        _xs = {bounds.getMinX(), bounds.getMaxX()};
+        _ys = {bounds.getMinY(), bounds.getMaxY()};
+        for (const Cell& c : blocked) {
+            _xs.push_back(c.minX);
+            _xs.push_back(c.maxX);
+            _ys.push_back(c.minY);
+            _ys.push_back(c.maxY);
+        }
+        std::sort(_xs.begin(), _xs.end());
+        _xs.erase(std::unique(_xs.begin(), _xs.end()), _xs.end());
+        std::sort(_ys.begin(), _ys.end());
+        _ys.erase(std::unique(_ys.begin(), _ys.end()), _ys.end());
+        int cols = (int)_xs.size() - 1;
+        int rows = (int)_ys.size() - 1;
+
+        // the grid borders include every obstacle edge, so each square is either free or covered
+        std::vector<bool> free((size_t)std::max(cols, 0) * std::max(rows, 0), true);
+        for (const Cell& c : blocked) {
+            int c0 = gridIndex(_xs, c.minX);
+            int c1 = gridIndex(_xs, c.maxX);
+            int r0 = gridIndex(_ys, c.minY);
+            int r1 = gridIndex(_ys, c.maxY);
+            for (int r = r0; r < r1; r++) {
+                for (int col = c0; col < c1; col++) {
+                    free[r * cols + col] = false;
+                }
+            }
+        }
+
+        // merge free squares into rectangles, widest first and then as tall as possible
+        _owner.assign(free.size(), -1);
+        for (int r = 0; r < rows; r++) {
+            for (int col = 0; col < cols; col++) {
+                if (!free[r * cols + col] || _owner[r * cols + col] != -1) {
+                    continue;
+                }
+                int right = col + 1;
+                while (right < cols && free[r * cols + right] && _owner[r * cols + right] == -1) {
+                    right += 1;
+                }
+                int top = r + 1;
+                while (top < rows && rowFree(free, top, col, right, cols)) {
+                    top += 1;
+                }
+                int id = (int)_cells.size();
+                for (int y = r; y < top; y++) {
+                    for (int x = col; x < right; x++) {
+                        _owner[y * cols + x] = id;
+                    }
+                }
+                _cells.push_back({_xs[col], _ys[r], _xs[right], _ys[top]});
+            }
+        }
+        connectCells(cols, rows);
+    }
+
+    /** Returns the number of cells */
+    int size() const {
+        return (int)_cells.size();
+    }
+
+    /** Returns the number of portals, counting each direction */
+    int portalCount() const {
+        return (int)_portals.size();
+    }
+
+    /** Returns the bounds of the given cell */
+    Rect cellBounds(int cell) const {
+        const Cell& c = _cells[cell];
+        return Rect(c.minX, c.minY, c.maxX - c.minX, c.maxY - c.minY);
+    }
+
+    /**
+     * Returns the cell containing the given point.
+     *
+     * @return the cell, or -1 if the point is inside an obstacle or off the map
+     */
+    int findCell(const Vec2& point) const {
+        if (_xs.size() < 2 || _ys.size() < 2) {
+            return -1;
+        }
+        if (point.x < _xs.front() || point.x > _xs.back() || point.y < _ys.front() || point.y > _ys.back()) {
+            return -1;
+        }
+        int cols = (int)_xs.size() - 1;
+        int col = std::min(gridIndex(_xs, point.x), cols - 1);
+        int row = std::min(gridIndex(_ys, point.y), (int)_ys.size() - 2);
+        return _owner[row * cols + col];
+    }
+
+    /**
+     * Returns the cell closest to the given point.
+     *
+     * Points inside an obstacle are moved onto the nearest cell.
+     *
+     * @param point The point, replaced by the closest point of the cell
+     *
+     * @return the cell, or -1 if the mesh is empty
+     */
+    int nearestCell(Vec2& point) const {
+        int cell = findCell(point);
+        if (cell != -1) {
+            return cell;
+        }
+        float best = std::numeric_limits<float>::infinity();
+        Vec2 closest = point;
+        for (int i = 0; i < _cells.size(); i++) {
+            const Cell& c = _cells[i];
+            Vec2 p(std::min(std::max(point.x, c.minX), c.maxX), std::min(std::max(point.y, c.minY), c.maxY));
+            float d = p.distanceSquared(point);
+            if (d < best) {
+                best = d;
+                closest = p;
+                cell = i;
+            }
+        }
+        point = closest;
+        return cell;
+    }
+
+    /**
+     * Finds the shortest path between two points.
+     *
+     * @param from  The start position
+     * @param to    The goal position
+     * @param out   Filled with the waypoints from `from` to `to` (inclusive)
+     *
+     * @return true if the goal is reachable; `out` is left empty otherwise
+     */
+    bool findPath(const Vec2& from, const Vec2& to, std::vector<Vec2>& out) {
+        out.clear();
+        Vec2 start = from;
+        Vec2 goal = to;
+        int startCell = nearestCell(start);
+        int goalCell = nearestCell(goal);
+        if (startCell == -1 || goalCell == -1 || !findRoute(start, startCell, goal, goalCell)) {
+            return false;
+        }
+        if (start != from) {
+            out.push_back(from);
+        }
+        funnel(start, goal, out);
+        if (goal != to) {
+            out.push_back(to);
+        }
+        return true;
+    }
+
+#pragma mark Helpers
+private:
+    /** Returns the grid border at or just below `value` */
+    static int gridIndex(const std::vector<float>& borders, float value) {
+        return (int)(std::upper_bound(borders.begin(), borders.end(), value) - borders.begin()) - 1;
+    }
+
+    /** Returns true if grid squares [from, to) of the given row are free and unclaimed */
+    bool rowFree(const std::vector<bool>& free, int row, int from, int to, int cols) const {
+        for (int x = from; x < to; x++) {
+            if (!free[row * cols + x] || _owner[row * cols + x] != -1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** Finds the portals between touching cells and stores them in compressed sparse row form */
+    void connectCells(int cols, int rows) {
+        std::set<std::pair<int,int>> pairs;
+        for (int r = 0; r < rows; r++) {
+            for (int col = 0; col < cols; col++) {
+                int a = _owner[r * cols + col];
+                if (a == -1) {
+                    continue;
+                }
+                int b = col + 1 < cols ? _owner[r * cols + col + 1] : -1;
+                if (b != -1 && b != a) {
+                    pairs.insert(std::make_pair(std::min(a, b), std::max(a, b)));
+                }
+                b = r + 1 < rows ? _owner[(r + 1) * cols + col] : -1;
+                if (b != -1 && b != a) {
+                    pairs.insert(std::make_pair(std::min(a, b), std::max(a, b)));
+                }
+            }
+        }
+
+        std::vector<std::vector<Portal>> portals(_cells.size());
+        for (auto& pair : pairs) {
+            const Cell& a = _cells[pair.first];
+            const Cell& b = _cells[pair.second];
+            Vec2 p;
+            Vec2 q;
+            if (a.maxX == b.minX || b.maxX == a.minX) {
+                float x = a.maxX == b.minX ? a.maxX : a.minX;
+                p = Vec2(x, std::max(a.minY, b.minY));
+                q = Vec2(x, std::min(a.maxY, b.maxY));
+            }
+            else {
+                float y = a.maxY == b.minY ? a.maxY : a.minY;
+                p = Vec2(std::max(a.minX, b.minX), y);
+                q = Vec2(std::min(a.maxX, b.maxX), y);
+            }
+            portals[pair.first].push_back({pair.second, p, q});
+            portals[pair.second].push_back({pair.first, p, q});
+        }
+
+        _portalStart.assign(_cells.size() + 1, 0);
+        for (int i = 0; i < _cells.size(); i++) {
+            _portalStart[i + 1] = _portalStart[i] + (int)portals[i].size();
+            _portals.insert(_portals.end(), portals[i].begin(), portals[i].end());
+        }
+    }
+
+    /**
+     * Runs A* over the portals and stores the cells from start to goal in _route.
+     *
+     * The search nodes are the portals rather than the cells, so that a cell
+     * can be crossed again from a different side. Each portal is crossed at
+     * its point closest to where the previous one was crossed, and node
+     * `portalCount()` stands for the goal itself.
+     */
+    bool findRoute(const Vec2& start, int startCell, const Vec2& goal, int goalCell) {
+        _route.clear();
+        _route.push_back(startCell);
+        if (startCell == goalCell) {
+            return true;
+        }
+        int goalNode = (int)_portals.size();
+        prepare(goalNode + 1);
+        _open.clear();
+        expand(startCell, -1, start, 0, goal, goalCell);
+
+        while (!_open.empty()) {
+            std::pop_heap(_open.begin(), _open.end(), compare);
+            OpenNode top = _open.back();
+            _open.pop_back();
+
+            int u = top.node;
+            if (_closed[u] == _generation || top.g > _g[u]) {
+                continue;
+            }
+            _closed[u] = _generation;
+            if (u == goalNode) {
+                int first = (int)_route.size();
+                for (int curr = _parent[goalNode]; curr != -1; curr = _parent[curr]) {
+                    _route.push_back(_portals[curr].cell);
+                }
+                std::reverse(_route.begin() + first, _route.end());
+                return true;
+            }
+            expand(_portals[u].cell, u, _entry[u], top.g, goal, goalCell);
+        }
+        return false;
+    }
+
+    /** Pushes the portals out of `cell`, which was entered through `node` at `entry` */
+    void expand(int cell, int node, const Vec2& entry, float g, const Vec2& goal, int goalCell) {
+        if (cell == goalCell) {
+            relax((int)_portals.size(), g + entry.distance(goal), node, goal, 0);
+            return;
+        }
+        for (int k = _portalStart[cell]; k < _portalStart[cell + 1]; k++) {
+            if (_closed[k] == _generation) {
+                continue;
+            }
+            Vec2 next = closestOnPortal(_portals[k], entry, goal);
+            relax(k, g + entry.distance(next), node, next, next.distance(goal));
+        }
+    }
+
+    void relax(int node, float g, int parent, const Vec2& entry, float h) {
+        if (_seen[node] != _generation || g < _g[node]) {
+            _g[node] = g;
+            _parent[node] = parent;
+            _entry[node] = entry;
+            _seen[node] = _generation;
+            _open.push_back({g + h, g, node});
+            std::push_heap(_open.begin(), _open.end(), compare);
+        }
+    }
+
+    /**
+     * Pulls the path through the portals of _route (the simple stupid funnel algorithm).
+     *
+     * The funnel keeps the tightest left and right edges seen from the apex.
+     * When the next portal crosses over one side, the path turns at the
+     * corner on that side, which becomes the new apex.
+     */
+    void funnel(const Vec2& start, const Vec2& goal, std::vector<Vec2>& out) {
+        _left.clear();
+        _right.clear();
+        _left.push_back(start);
+        _right.push_back(start);
+        for (int k = 0; k + 1 < _route.size(); k++) {
+            const Portal& portal = findPortal(_route[k], _route[k + 1]);
+            // orient the portal so that `left` is on the left of the direction of travel
+            Vec2 across = _cells[_route[k + 1]].minX >= _cells[_route[k]].maxX || _cells[_route[k + 1]].maxX <= _cells[_route[k]].minX
+                ? Vec2(_cells[_route[k + 1]].minX - _cells[_route[k]].minX, 0)
+                : Vec2(0, _cells[_route[k + 1]].minY - _cells[_route[k]].minY);
+            if (across.cross(portal.b - portal.a) > 0) {
+                _left.push_back(portal.b);
+                _right.push_back(portal.a);
+            }
+            else {
+                _left.push_back(portal.a);
+                _right.push_back(portal.b);
+            }
+        }
+        _left.push_back(goal);
+        _right.push_back(goal);
+
+        Vec2 apex = start;
+        Vec2 left = _left[0];
+        Vec2 right = _right[0];
+        int apexIndex = 0;
+        int leftIndex = 0;
+        int rightIndex = 0;
+        out.push_back(start);
+        for (int k = 1; k < _left.size(); k++) {
+            const Vec2& nextLeft = _left[k];
+            const Vec2& nextRight = _right[k];
+
+            // try to narrow the right side
+            if (side(apex, right, nextRight) >= 0) {
+                if (apex == right || side(apex, left, nextRight) < 0) {
+                    right = nextRight;
+                    rightIndex = k;
+                }
+                else {
+                    // the right side crossed the left one, turn at the left corner
+                    apex = left;
+                    apexIndex = leftIndex;
+                    pushCorner(out, apex);
+                    left = apex;
+                    right = apex;
+                    leftIndex = apexIndex;
+                    rightIndex = apexIndex;
+                    k = apexIndex;
+                    continue;
+                }
+            }
+
+            // try to narrow the left side
+            if (side(apex, left, nextLeft) <= 0) {
+                if (apex == left || side(apex, right, nextLeft) > 0) {
+                    left = nextLeft;
+                    leftIndex = k;
+                }
+                else {
+                    // the left side crossed the right one, turn at the right corner
+                    apex = right;
+                    apexIndex = rightIndex;
+                    pushCorner(out, apex);
+                    left = apex;
+                    right = apex;
+                    leftIndex = apexIndex;
+                    rightIndex = apexIndex;
+                    k = apexIndex;
+                    continue;
+                }
+            }
+        }
+        pushCorner(out, goal);
+    }
+
+    /** Returns where the portal crosses the line from `from` to `goal`, clamped to its end points */
+    static Vec2 closestOnPortal(const Portal& portal, const Vec2& from, const Vec2& goal) {
+        Vec2 edge = portal.b - portal.a;
+        Vec2 line = goal - from;
+        float denom = line.cross(edge);
+        float t;
+        if (denom != 0) {
+            t = line.cross(portal.a - from) / -denom;
+        }
+        else {
+            t = edge.dot(from - portal.a) / std::max(edge.lengthSquared(), 1e-6f);
+        }
+        return portal.a + edge * std::min(std::max(t, 0.0f), 1.0f);
+    }
+
+    /** Returns the portal from cell `a` to cell `b` */
+    const Portal& findPortal(int a, int b) const {
+        int k = _portalStart[a];
+        while (_portals[k].cell != b) {
+            k += 1;
+        }
+        return _portals[k];
+    }
+
+    /** Returns > 0 if `p` is to the left of the ray from `a` through `b`, < 0 if to the right */
+    static float side(const Vec2& a, const Vec2& b, const Vec2& p) {
+        return (b - a).cross(p - a);
+    }
+
+    static void pushCorner(std::vector<Vec2>& out, const Vec2& corner) {
+        if (out.back() != corner) {
+            out.push_back(corner);
+        }
+    }
+
+    /** Grows the search buffers and starts a new generation */
+    void prepare(int n) {
+        if ((int)_g.size() < n) {
+            _g.resize(n);
+            _parent.resize(n);
+            _entry.resize(n);
+            _seen.resize(n, 0);
+            _closed.resize(n, 0);
+        }
+        _generation += 1;
+        if (_generation == 0) {
+            // the counter wrapped around, old stamps are no longer safe
+            std::fill(_seen.begin(), _seen.end(), 0);
+            std::fill(_closed.begin(), _closed.end(), 0);
+            _generation = 1;
+        }
+    }
+
+    /** Heap order: lowest f first, ties broken towards the deeper node */
+    static bool compare(const OpenNode& a, const OpenNode& b) {
+        if (a.f != b.f) {
+            return a.f > b.f;
+        }
+        return a.g < b.g;
+    }
+};
+
+#endif /* __NAV_MESH_H__ */
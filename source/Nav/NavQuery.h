@@ -0,0 +1,236 @@
+//
+//  NavQuery.h
+//  Tilemap
+//
+//  Nearest navigation node lookup.
+//
+
+#ifndef __NAV_QUERY_H__
+#define __NAV_QUERY_H__
+
+#include "NavGraph.h"
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+/**
+ * Answers "which nav node is closest to this position" in constant time.
+ *
+ * Graphs built by `TilemapController::getEdges` are regular lattices, so the
+ * closest node follows from rounding the position to the lattice. If that
+ * node is blocked (it has no edges, which is what happens to nodes inside
+ * obstacles) the query falls back to a bucket grid over the open nodes and
+ * searches outwards ring by ring. Graphs that are not lattices always use
+ * the bucket grid.
+ */
+class NavQuery {
+
+#pragma mark Internal References
+private:
+    std::shared_ptr<NavGraph> _graph;
+
+    /** Whether the graph is a regular lattice */
+    bool _isLattice;
+    /** Position of node 0, the top left node of the lattice */
+    Vec2 _latticeOrigin;
+    /** Distance between neighbouring lattice nodes */
+    float _latticeStep;
+    int _latticeCols;
+    int _latticeRows;
+
+    /** Bottom left corner of the bucket grid */
+    Vec2 _gridOrigin;
+    /** Width and height of a bucket */
+    float _cellSize;
+    int _gridCols;
+    int _gridRows;
+    /** Start of each bucket in _cellNodes; has one extra entry at the end */
+    std::vector<int> _cellStart;
+    /** Open nodes sorted by bucket */
+    std::vector<int> _cellNodes;
+
+#pragma mark Main Methods
+public:
+    NavQuery(const std::shared_ptr<NavGraph>& graph) {
+        _graph = graph;
+        detectLattice();
+        buildGrid();
+    }
+
+    /**
+     * Returns the open node closest to the given position.
+     *
+     * If the graph has no open node at all, returns the closest node.
+     *
+     * @param pos   The position to look up
+     */
+    int closestNode(Vec2 pos) const {
+        if (_graph->size() == 0) {
+            return 0;
+        }
+        if (_isLattice) {
+            int node = latticeNode(pos);
+            if (_graph->degree(node) > 0 || _cellNodes.empty()) {
+                return node;
+            }
+        }
+        if (_cellNodes.empty()) {
+            return linearNode(pos);
+        }
+        return bucketNode(pos);
+    }
+
+    /** Returns true if the graph is a regular lattice */
+    bool isLattice() const {
+        return _isLattice;
+    }
+
+#pragma mark Helpers
+private:
+    /** Checks whether every node sits on the lattice `getEdges` would produce */
+    void detectLattice() {
+        _isLattice = false;
+        int n = _graph->size();
+        if (n < 2) {
+            return;
+        }
+        _latticeOrigin = _graph->position(0);
+        _latticeCols = 1;
+        while (_latticeCols < n && _graph->position(_latticeCols).y == _latticeOrigin.y) {
+            _latticeCols += 1;
+        }
+        if (_latticeCols < 2 || n % _latticeCols != 0) {
+            return;
+        }
+        _latticeRows = n / _latticeCols;
+        _latticeStep = _graph->position(1).x - _latticeOrigin.x;
+        if (_latticeStep <= 0) {
+            return;
+        }
+        for (int i = 0; i < n; i++) {
+            Vec2 expected = _latticeOrigin + Vec2((i % _latticeCols) * _latticeStep, -(i / _latticeCols) * _latticeStep);
+            if (_graph->position(i).distanceSquared(expected) > 0.01f) {
+                return;
+            }
+        }
+        _isLattice = true;
+    }
+
+    /** Buckets every open node by position */
+    void buildGrid() {
+        int n = _graph->size();
+        Vec2 lo(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+        Vec2 hi(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+        int open = 0;
+        for (int i = 0; i < n; i++) {
+            const Vec2& p = _graph->position(i);
+            lo = Vec2(std::min(lo.x, p.x), std::min(lo.y, p.y));
+            hi = Vec2(std::max(hi.x, p.x), std::max(hi.y, p.y));
+            open += _graph->degree(i) > 0 ? 1 : 0;
+        }
+        _cellStart.clear();
+        _cellNodes.clear();
+        if (open == 0) {
+            return;
+        }
+
+        // about one node per bucket
+        float area = std::max(hi.x - lo.x, 1.0f) * std::max(hi.y - lo.y, 1.0f);
+        _cellSize = _isLattice ? _latticeStep : std::sqrt(area / n);
+        _cellSize = std::max(_cellSize, 1.0f);
+        _gridOrigin = lo;
+        _gridCols = (int)((hi.x - lo.x) / _cellSize) + 1;
+        _gridRows = (int)((hi.y - lo.y) / _cellSize) + 1;
+
+        _cellStart.assign(_gridCols * _gridRows + 1, 0);
+        for (int i = 0; i < n; i++) {
+            if (_graph->degree(i) > 0) {
+                _cellStart[cellOf(_graph->position(i)) + 1] += 1;
+            }
+        }
+        for (int c = 0; c < _gridCols * _gridRows; c++) {
+            _cellStart[c + 1] += _cellStart[c];
+        }
+        _cellNodes.resize(open);
+        std::vector<int> fill(_cellStart.begin(), _cellStart.end() - 1);
+        for (int i = 0; i < n; i++) {
+            if (_graph->degree(i) > 0) {
+                _cellNodes[fill[cellOf(_graph->position(i))]++] = i;
+            }
+        }
+    }
+
+    int latticeNode(Vec2 pos) const {
+        int col = (int)std::lround((pos.x - _latticeOrigin.x) / _latticeStep);
+        int row = (int)std::lround((_latticeOrigin.y - pos.y) / _latticeStep);
+        col = std::max(0, std::min(col, _latticeCols - 1));
+        row = std::max(0, std::min(row, _latticeRows - 1));
+        return row * _latticeCols + col;
+    }
+
+    int cellCol(float x) const {
+        return std::max(0, std::min((int)std::floor((x - _gridOrigin.x) / _cellSize), _gridCols - 1));
+    }
+
+    int cellRow(float y) const {
+        return std::max(0, std::min((int)std::floor((y - _gridOrigin.y) / _cellSize), _gridRows - 1));
+    }
+
+    int cellOf(const Vec2& p) const {
+        return cellRow(p.y) * _gridCols + cellCol(p.x);
+    }
+
+    /** Searches the buckets ring by ring until no closer node can exist */
+    int bucketNode(Vec2 pos) const {
+        int cx = cellCol(pos.x);
+        int cy = cellRow(pos.y);
+        int best = -1;
+        float bestDist = std::numeric_limits<float>::max();
+        int maxRing = std::max(_gridCols, _gridRows);
+        for (int r = 0; r <= maxRing; r++) {
+            for (int y = cy - r; y <= cy + r; y++) {
+                if (y < 0 || y >= _gridRows) {
+                    continue;
+                }
+                // only the border of the ring, the inside was searched already
+                int step = (y == cy - r || y == cy + r) ? 1 : std::max(2 * r, 1);
+                for (int x = cx - r; x <= cx + r; x += step) {
+                    if (x < 0 || x >= _gridCols) {
+                        continue;
+                    }
+                    int c = y * _gridCols + x;
+                    for (int k = _cellStart[c]; k < _cellStart[c + 1]; k++) {
+                        float d = pos.distanceSquared(_graph->position(_cellNodes[k]));
+                        if (d < bestDist || (d == bestDist && _cellNodes[k] < best)) {
+                            bestDist = d;
+                            best = _cellNodes[k];
+                        }
+                    }
+                }
+            }
+            // every bucket outside this ring is at least r cells away
+            float reach = r * _cellSize;
+            if (best != -1 && bestDist <= reach * reach) {
+                break;
+            }
+        }
+        return best;
+    }
+
+    int linearNode(Vec2 pos) const {
+        int best = 0;
+        float bestDist = std::numeric_limits<float>::max();
+        for (int i = 0; i < _graph->size(); i++) {
+            float d = pos.distanceSquared(_graph->position(i));
+            if (d < bestDist) {
+                bestDist = d;
+                best = i;
+            }
+        }
+        return best;
+    }
+};
+
+#endif /* __NAV_QUERY_H__ */
@@ -0,0 +1,317 @@
+//
+//  NavVisibility.h
+//  Tilemap
+//
+//  Precomputed line of sight between every pair of nav nodes.
+//
+
+#ifndef __NAV_VISIBILITY_H__
+#define __NAV_VISIBILITY_H__
+
+#include "NavGraph.h"
+#include "NavQuery.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <functional>
+
+/**
+ * A visibility matrix over the nodes of one nav graph.
+ *
+ * Row `u` holds one bit per node, set if the straight segment from `u` to
+ * that node is clear, so asking whether two nodes see each other is a single
+ * bit test. The rows are packed into 64 bit words, n^2 / 8 bytes in total.
+ *
+ * The matrix is symmetric, so the build only tests the pairs above the
+ * diagonal, shared row by row between the worker threads, and mirrors them
+ * afterwards. Nodes whose own position is blocked see nothing; their rows
+ * are skipped.
+ *
+ * The matrix answers for the exact node positions only. Positions that are
+ * not on a node go through `canSee`, which falls back to the raycast. It is
+ * only valid for the obstacles it was built from.
+ */
+class NavVisibility {
+
+#pragma mark Constants
+public:
+    /** Largest graph a matrix is built for, 8 MB of bits */
+    static constexpr int MAX_NODES = 8192;
+    /** How far a position may be from a node and still count as on it */
+    static constexpr float SNAP_DISTANCE = 0.01f;
+
+    /** Returns true if the straight segment between two points is blocked */
+    typedef std::function<bool(const Vec2&, const Vec2&)> Blocked;
+
+#pragma mark Internal References
+private:
+    /** Number of nodes of the graph the matrix was built for */
+    int _size;
+    /** 64 bit words per row */
+    int _stride;
+    /** The rows of the matrix, one after another */
+    std::vector<uint64_t> _bits;
+    /** Time it took to build the matrix, 0 if it was loaded */
+    float _buildMillis;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Builds the matrix for the given graph.
+     *
+     * `blocked` is called from the worker threads at the same time, so it
+     * must not change any state. `ItemSetController::segmentInObstacle`
+     * qualifies once the set's snapshot is up to date.
+     *
+     * @param graph     The nav graph, see `supports`
+     * @param blocked   The line of sight test
+     * @param pool      Worker threads to share the rows between, or nullptr
+     */
+    NavVisibility(const NavGraph& graph, const Blocked& blocked, ThreadPool* pool = nullptr) {
+        auto start = std::chrono::steady_clock::now();
+        init(graph.size());
+        int n = _size;
+
+        // a node inside an obstacle is blocked even from itself
+        std::vector<uint8_t> open(n);
+        for (int u = 0; u < n; u++) {
+            open[u] = !blocked(graph.position(u), graph.position(u));
+        }
+
+        // every row only tests the nodes after it, so rows never share a word
+        auto fillRow = [this, &graph, &blocked, &open, n](int u) {
+            if (!open[u]) {
+                return;
+            }
+            set(u, u);
+            Vec2 from = graph.position(u);
+            for (int v = u + 1; v < n; v++) {
+                if (open[v] && !blocked(from, graph.position(v))) {
+                    set(u, v);
+                }
+            }
+        };
+        if (pool == nullptr) {
+            for (int u = 0; u < n; u++) {
+                fillRow(u);
+            }
+        }
+        else {
+            // interleave the rows, they get shorter towards the end
+            int workers = pool->size();
+            for (int w = 0; w < workers; w++) {
+                pool->submit([&fillRow, w, workers, n](int worker) {
+                    for (int u = w; u < n; u += workers) {
+                        fillRow(u);
+                    }
+                });
+            }
+            pool->wait();
+        }
+
+        // mirror the upper triangle into the lower one
+        for (int u = 0; u < n; u++) {
+            const uint64_t* row = _bits.data() + (size_t)u * _stride;
+            for (int word = (u + 1) / 64; word < _stride; word++) {
+                uint64_t bits = row[word];
+                if (word == (u + 1) / 64) {
+                    bits &= ~(uint64_t)0 << ((u + 1) % 64);
+                }
+                while (bits != 0) {
+                    int v = word * 64 + lowestBit(bits);
+                    set(v, u);
+                    bits &= bits - 1;
+                }
+            }
+        }
+        _buildMillis = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /** Returns true if a matrix can be built for the given graph */
+    static bool supports(const NavGraph& graph) {
+        return graph.size() <= MAX_NODES;
+    }
+
+    /**
+     * Returns a matrix read from a baked JSON section, or nullptr if it is malformed.
+     *
+     * The section has the format written by `toJson`: `{"rows": [...], "runs": [...]}`.
+     * Each row is stored as the lengths of its alternating runs of hidden
+     * and visible nodes, starting with a hidden run.
+     *
+     * @param json  The baked matrix
+     * @param graph The graph the matrix must belong to
+     */
+    static std::shared_ptr<NavVisibility> alloc(const std::shared_ptr<JsonValue>& json, const NavGraph& graph) {
+        if (json == nullptr || !json->has("rows") || !json->has("runs")) {
+            return nullptr;
+        }
+        auto rows = json->get("rows");
+        auto runs = json->get("runs");
+        if (rows->size() != graph.size() + 1 || rows->get(0)->asInt() != 0 || rows->get(graph.size())->asInt() != runs->size()) {
+            return nullptr;
+        }
+
+        std::shared_ptr<NavVisibility> matrix(new NavVisibility());
+        matrix->init(graph.size());
+        for (int u = 0; u < graph.size(); u++) {
+            int first = rows->get(u)->asInt();
+            int last = rows->get(u + 1)->asInt();
+            if (first > last || last > runs->size()) {
+                return nullptr;
+            }
+            int v = 0;
+            bool seen = false;
+            for (int k = first; k < last; k++, seen = !seen) {
+                int length = runs->get(k)->asInt();
+                if (length < 0 || v + length > graph.size()) {
+                    return nullptr;
+                }
+                for (int end = v + length; v < end; v++) {
+                    if (seen) {
+                        matrix->set(u, v);
+                    }
+                }
+            }
+            if (v != graph.size()) {
+                return nullptr;
+            }
+        }
+        return matrix;
+    }
+
+    /** Returns this matrix as a JSON section that `alloc` can read back */
+    std::shared_ptr<JsonValue> toJson() const {
+        std::shared_ptr<JsonValue> json = JsonValue::allocObject();
+        std::shared_ptr<JsonValue> rows = JsonValue::allocArray();
+        std::shared_ptr<JsonValue> runs = JsonValue::allocArray();
+        long count = 0;
+        for (int u = 0; u < _size; u++) {
+            rows->appendChild(JsonValue::alloc(count));
+            bool seen = false;
+            int length = 0;
+            for (int v = 0; v < _size; v++) {
+                if (visible(u, v) != seen) {
+                    runs->appendChild(JsonValue::alloc((long)length));
+                    count += 1;
+                    seen = !seen;
+                    length = 0;
+                }
+                length += 1;
+            }
+            runs->appendChild(JsonValue::alloc((long)length));
+            count += 1;
+        }
+        rows->appendChild(JsonValue::alloc(count));
+        json->appendChild("rows", rows);
+        json->appendChild("runs", runs);
+        return json;
+    }
+
+#pragma mark Queries
+public:
+    /** Returns the number of nodes of the graph the matrix belongs to */
+    int size() const {
+        return _size;
+    }
+
+    /** Returns true if the straight segment between two nodes is clear */
+    bool visible(int u, int v) const {
+        return (_bits[(size_t)u * _stride + v / 64] >> (v % 64)) & 1;
+    }
+
+    /**
+     * Returns the node at the given position, or -1 if it is not on one.
+     *
+     * @param graph The graph the matrix was built for
+     * @param query The nearest node lookup of that graph
+     * @param pos   The position to look up
+     */
+    int nodeAt(const NavGraph& graph, const NavQuery& query, const Vec2& pos) const {
+        int node = query.closestNode(pos);
+        if (node < 0 || node >= _size || graph.position(node).distanceSquared(pos) > SNAP_DISTANCE * SNAP_DISTANCE) {
+            return -1;
+        }
+        return node;
+    }
+
+    /**
+     * Returns true if the two positions can see each other.
+     *
+     * If both positions are on nodes this is a bit test; otherwise it runs
+     * `blocked`.
+     *
+     * @param graph     The graph the matrix was built for
+     * @param query     The nearest node lookup of that graph
+     * @param a         The first position
+     * @param b         The second position
+     * @param blocked   The line of sight test for positions off the nodes
+     */
+    template <typename Test>
+    bool canSee(const NavGraph& graph, const NavQuery& query, const Vec2& a, const Vec2& b, Test blocked) const {
+        int u = nodeAt(graph, query, a);
+        int v = u == -1 ? -1 : nodeAt(graph, query, b);
+        if (v != -1) {
+            return visible(u, v);
+        }
+        return !blocked(a, b);
+    }
+
+#pragma mark Statistics
+public:
+    /** Returns the memory taken by the matrix in bytes */
+    size_t memoryBytes() const {
+        return _bits.size() * sizeof(uint64_t);
+    }
+
+    /**
+     * Logs the size of this matrix.
+     *
+     * @param name  The name of the level world, for the log
+     */
+    void report(const std::string& name) const {
+        size_t pairs = 0;
+        for (uint64_t word : _bits) {
+            for (uint64_t bits = word; bits != 0; bits &= bits - 1) {
+                pairs += 1;
+            }
+        }
+        CULog("Visibility matrix %s: %d nodes, %.1f%% of pairs visible, %.1f KB, built in %.1f ms",
+              name.c_str(), _size, _size > 0 ? 100.0f * pairs / ((float)_size * _size) : 0.0f,
+              memoryBytes() / 1024.0f, _buildMillis);
+    }
+
+#pragma mark Helpers
+private:
+    void init(int size) {
+        _size = size;
+        _stride = (size + 63) / 64;
+        _bits.assign((size_t)size * _stride, 0);
+    }
+
+    void set(int u, int v) {
+        _bits[(size_t)u * _stride + v / 64] |= (uint64_t)1 << (v % 64);
+    }
+
+    /** Returns the index of the lowest set bit of a nonzero word */
+    static int lowestBit(uint64_t bits) {
+        int index = 0;
+        while ((bits & 1) == 0) {
+            bits >>= 1;
+            index += 1;
+        }
+        return index;
+    }
+
+    /** Creates an empty matrix to be filled by `alloc` */
+    NavVisibility() {
+        _size = 0;
+        _stride = 0;
+        _buildMillis = 0;
+    }
+};
+
+#endif /* __NAV_VISIBILITY_H__ */
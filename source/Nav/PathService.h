@@ -0,0 +1,202 @@
+//
+//  PathService.h
+//  Tilemap
+//
+//  Asynchronous path queries on a shared nav graph.
+//
+
+#ifndef __PATH_SERVICE_H__
+#define __PATH_SERVICE_H__
+
+#include "NavGraph.h"
+#include "NavHierarchy.h"
+#include "AStarSearch.h"
+#include "HierarchicalSearch.h"
+#include "FirstMoveTable.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <deque>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+
+/**
+ * Runs path searches on worker threads and hands back the results later.
+ *
+ * Queries are answered with the best engine the level has: a first-move
+ * table lookup, then hierarchical search, then flat A*.
+ *
+ * `request` returns a ticket straight away and queues the search on the
+ * thread pool. The searches only read the nav graph and its hierarchy,
+ * which never change after the level loads, and each worker has its own
+ * search buffers, so no locking is needed while searching. Finished paths
+ * wait in a queue until the game loop calls `collect`, which hands back at
+ * most `budget` of them so that a burst of requests is spread over several
+ * frames instead of stalling one.
+ */
+class PathService {
+
+#pragma mark Types
+public:
+    /** Identifies one request; never NO_TICKET */
+    typedef unsigned int Ticket;
+    static constexpr Ticket NO_TICKET = 0;
+    /** Default number of results handed back per frame */
+    static constexpr int DEFAULT_BUDGET = 4;
+
+    /** A finished request */
+    struct Result {
+        Ticket ticket;
+        /** The goal node of the request */
+        int goal;
+        /** Whether the goal is reachable */
+        bool found;
+        /** The node ids from start to goal (inclusive), empty if not found */
+        std::vector<int> nodes;
+    };
+
+#pragma mark Internal References
+private:
+    /** Everything the jobs touch, kept alive by the jobs still in flight */
+    struct State {
+        std::shared_ptr<const NavGraph> graph;
+        std::shared_ptr<const NavHierarchy> hierarchy;
+        std::shared_ptr<const FirstMoveTable> moves;
+        /** One search per worker thread */
+        std::vector<AStarSearch> flat;
+        std::vector<HierarchicalSearch> hierarchical;
+        std::mutex mutex;
+        /** Requests that are queued or running and have not been cancelled */
+        std::unordered_set<Ticket> inFlight;
+        std::deque<Result> done;
+    };
+
+    std::shared_ptr<ThreadPool> _pool;
+    std::shared_ptr<State> _state;
+    Ticket _nextTicket;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Creates a service answering queries on the given graph.
+     *
+     * @param pool      The worker threads; may be shared with other services
+     * @param graph     The nav graph
+     * @param hierarchy The abstraction of the graph, or nullptr
+     * @param moves     The first-move table of the graph, or nullptr
+     */
+    PathService(std::shared_ptr<ThreadPool> pool, std::shared_ptr<const NavGraph> graph,
+                std::shared_ptr<const NavHierarchy> hierarchy, std::shared_ptr<const FirstMoveTable> moves) {
+        _pool = pool;
+        _state = std::make_shared<State>();
+        _state->graph = graph;
+        _state->hierarchy = hierarchy;
+        _state->moves = moves;
+        _state->flat.resize(pool->size());
+        _state->hierarchical.resize(pool->size());
+        _nextTicket = NO_TICKET;
+    }
+
+    ~PathService() {
+        cancelAll();
+    }
+
+    /**
+     * Queues a search from `start` to `goal`.
+     *
+     * @return the ticket that identifies the result
+     */
+    Ticket request(int start, int goal) {
+        _nextTicket += 1;
+        if (_nextTicket == NO_TICKET) {
+            _nextTicket += 1;
+        }
+        Ticket ticket = _nextTicket;
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            _state->inFlight.insert(ticket);
+        }
+
+        std::shared_ptr<State> state = _state;
+        _pool->submit([state, ticket, start, goal](int worker) {
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->inFlight.count(ticket) == 0) {
+                    return;
+                }
+            }
+            Result result;
+            result.ticket = ticket;
+            result.goal = goal;
+            result.found = search(*state, state->flat[worker], state->hierarchical[worker], start, goal, result.nodes);
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->inFlight.erase(ticket) > 0) {
+                state->done.push_back(std::move(result));
+            }
+        });
+        return ticket;
+    }
+
+    /** Drops a request; its result will never be collected */
+    void cancel(Ticket ticket) {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        if (_state->inFlight.erase(ticket) > 0) {
+            return;
+        }
+        for (auto it = _state->done.begin(); it != _state->done.end(); ++it) {
+            if (it->ticket == ticket) {
+                _state->done.erase(it);
+                return;
+            }
+        }
+    }
+
+    /** Drops every request that has not been collected yet */
+    void cancelAll() {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        _state->inFlight.clear();
+        _state->done.clear();
+    }
+
+    /**
+     * Moves finished results into `out`, oldest first.
+     *
+     * @param out       The results are appended here
+     * @param budget    The most results to hand back
+     *
+     * @return the number of results handed back
+     */
+    int collect(std::vector<Result>& out, int budget) {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        int count = 0;
+        while (count < budget && !_state->done.empty()) {
+            out.push_back(std::move(_state->done.front()));
+            _state->done.pop_front();
+            count += 1;
+        }
+        return count;
+    }
+
+    /** Returns the number of requests that have not been collected yet */
+    int pending() const {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        return (int)(_state->inFlight.size() + _state->done.size());
+    }
+
+#pragma mark Helpers
+private:
+    /** Answers a query with the best engine available */
+    static bool search(const State& state, AStarSearch& flat, HierarchicalSearch& hierarchical,
+                       int start, int goal, std::vector<int>& out) {
+        if (state.moves != nullptr) {
+            return state.moves->extractPath(*state.graph, start, goal, out);
+        }
+        if (state.hierarchy != nullptr) {
+            return hierarchical.findPath(*state.graph, *state.hierarchy, start, goal, out);
+        }
+        return flat.findPath(*state.graph, start, goal, out);
+    }
+};
+
+#endif /* __PATH_SERVICE_H__ */
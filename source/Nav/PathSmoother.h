@@ -0,0 +1,79 @@
+//
+//  PathSmoother.h
+//  Tilemap
+//
+//  Any-angle post-processing of lattice paths.
+//
+
+#ifndef __PATH_SMOOTHER_H__
+#define __PATH_SMOOTHER_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <functional>
+using namespace cugl;
+
+/**
+ * Shortens a lattice path by string pulling.
+ *
+ * Paths from the nav graph move one lattice step at a time, so a guard would
+ * get one MoveTo per step. Smoothing first drops waypoints that sit on a
+ * straight line between their neighbours, then skips every waypoint the guard
+ * can already see past. The first and last waypoints are always kept.
+ */
+class PathSmoother {
+
+#pragma mark Main Methods
+public:
+    /** Returns true if the straight segment between two points is blocked */
+    typedef std::function<bool(const Vec2&, const Vec2&)> Blocked;
+
+    /**
+     * Removes the waypoints the guard does not need to turn at.
+     *
+     * Every segment of the result is either a segment of the input or was
+     * tested with `blocked`.
+     *
+     * @param path      The path to smooth, modified in place
+     * @param blocked   The line of sight test
+     */
+    static void smooth(std::vector<Vec2>& path, const Blocked& blocked) {
+        removeCollinear(path);
+        if (path.size() <= 2) {
+            return;
+        }
+
+        // walk along the path and only keep the waypoints where line of sight breaks
+        int write = 1;
+        Vec2 anchor = path[0];
+        for (int k = 1; k + 1 < path.size(); k++) {
+            if (blocked(anchor, path[k + 1])) {
+                anchor = path[k];
+                path[write++] = path[k];
+            }
+        }
+        path[write++] = path.back();
+        path.resize(write);
+    }
+
+#pragma mark Helpers
+private:
+    /** Drops the waypoints that lie on the segment between their neighbours */
+    static void removeCollinear(std::vector<Vec2>& path) {
+        if (path.size() <= 2) {
+            return;
+        }
+        int write = 1;
+        for (int k = 1; k + 1 < path.size(); k++) {
+            Vec2 in = path[k] - path[write - 1];
+            Vec2 out = path[k + 1] - path[k];
+            if (std::abs(in.cross(out)) > 0.001f || in.dot(out) <= 0) {
+                path[write++] = path[k];
+            }
+        }
+        path[write++] = path.back();
+        path.resize(write);
+    }
+};
+
+#endif /* __PATH_SMOOTHER_H__ */
@@ -0,0 +1,123 @@
+//
+//  ThreadPool.h
+//  Tilemap
+//
+//  Fixed set of worker threads for navigation jobs.
+//
+
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+/**
+ * A fixed number of worker threads that run jobs in submission order.
+ *
+ * Every job is given the index of the worker running it, so that callers
+ * can keep one set of scratch buffers per worker instead of locking. Jobs
+ * still queued when the pool is destroyed are dropped.
+ */
+class ThreadPool {
+
+#pragma mark Internal References
+private:
+    std::vector<std::thread> _workers;
+    std::deque<std::function<void(int)>> _jobs;
+    std::mutex _mutex;
+    /** Signalled when a job is queued or the pool stops */
+    std::condition_variable _wake;
+    /** Signalled when a worker runs out of jobs */
+    std::condition_variable _idle;
+    /** Number of jobs currently running */
+    int _busy;
+    bool _stop;
+
+#pragma mark Main Methods
+public:
+    /**
+     * Starts the worker threads.
+     *
+     * @param workers   The number of threads, at least one
+     */
+    ThreadPool(int workers) {
+        _busy = 0;
+        _stop = false;
+        workers = std::max(workers, 1);
+        for (int w = 0; w < workers; w++) {
+            _workers.emplace_back([this, w] { run(w); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+            _jobs.clear();
+        }
+        _wake.notify_all();
+        for (auto& worker : _workers) {
+            worker.join();
+        }
+    }
+
+    /** Returns a worker count that leaves one core to the main thread */
+    static int defaultSize() {
+        return std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    }
+
+    /** Returns the number of worker threads */
+    int size() const {
+        return (int)_workers.size();
+    }
+
+    /**
+     * Queues a job.
+     *
+     * @param job   The job, called with the index of the worker running it
+     */
+    void submit(std::function<void(int)> job) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _jobs.push_back(std::move(job));
+        }
+        _wake.notify_one();
+    }
+
+    /** Blocks until every queued job has finished */
+    void wait() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _idle.wait(lock, [this] { return _jobs.empty() && _busy == 0; });
+    }
+
+#pragma mark Helpers
+private:
+    void run(int worker) {
+        while (true) {
+            std::function<void(int)> job;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [this] { return _stop || !_jobs.empty(); });
+                if (_stop) {
+                    return;
+                }
+                job = std::move(_jobs.front());
+                _jobs.pop_front();
+                _busy += 1;
+            }
+            job(worker);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _busy -= 1;
+            }
+            _idle.notify_all();
+        }
+    }
+};
+
+#endif /* __THREAD_POOL_H__ */
@@ -1,5 +1,6 @@
 #include <chrono>
 #include "GamePlayController.h"
+#include <GuardSet/GuardBenchmark.h>
 #include <chrono>
 #include <thread>
 #include "Level/LevelConstants.h"
@@ -16,6 +17,10 @@ using namespace cugl;
 #define PREVIEW_RADIUS 200
 #define SWITCH_DURATION 1
 #define ACT_KEY  "current"
+/** How far the drawn path has to stay from the obstacles */
+#define PATH_CLEARANCE 5
+/** Frames between two guard timing reports in stress levels */
+#define STRESS_REPORT_FRAMES 120
 
 GamePlayController::GamePlayController(const Size displaySize, std::shared_ptr<cugl::AssetManager>& assets ):
 _scene(cugl::Scene2::alloc(displaySize)), _other_scene(cugl::Scene2::alloc(displaySize)),  _UI_scene(cugl::Scene2::alloc(displaySize)){
@@ -53,8 +58,12 @@ _scene(cugl::Scene2::alloc(displaySize)), _other_scene(cugl::Scene2::alloc(displ
     _other_cam = _other_scene->getCamera();
     _UI_cam = _UI_scene->getCamera();
     
+    // Start the workers for the guard path searches
+    _navWorkers = std::make_shared<ThreadPool>(ThreadPool::defaultSize());
+    
     // Allocate the manager and the actions
     _actions = cugl::scene2::ActionManager::alloc();
+    _entityActions = ActionSlots::alloc();
     _action_world_switch = cugl::scene2::ActionManager::alloc();
     
     // Allocate the camera manager
@@ -296,10 +305,15 @@ _scene(cugl::Scene2::alloc(displaySize)), _other_scene(cugl::Scene2::alloc(displ
 }
 
 void GamePlayController::loadLevel(){
-    string pastFile = "tileset/levels/level-" + std::to_string(level) + "-past.json";
-    string pastKey = "level-" + std::to_string(level) + "-past";
-    string presentFile = "tileset/levels/level-" + std::to_string(level) + "-present.json";
-    string presentKey = "level-" + std::to_string(level) + "-present";
+    int number = level;
+#ifdef GUARD_STRESS
+    // stress builds play the stress level whatever level was chosen
+    number = STRESS_LEVEL;
+#endif
+    string pastFile = "tileset/levels/level-" + std::to_string(number) + "-past.json";
+    string pastKey = "level-" + std::to_string(number) + "-past";
+    string presentFile = "tileset/levels/level-" + std::to_string(number) + "-present.json";
+    string presentKey = "level-" + std::to_string(number) + "-present";
     
     _assets->unload<LevelController>(pastKey);
     _assets->unload<LevelController>(presentKey);
@@ -321,11 +335,9 @@ void GamePlayController::loadLevel(){
     _shadowSetPast->updateTransparency();
     // artifact
     _artifactSet = _pastWorldLevel->getItem();
-    _artifactSet->setAction(_actions);
     artNum = _artifactSet->getArtNum();
     // resources
     _resourceSet = _pastWorldLevel->getResources();
-    _resourceSet->setAction(_actions);
     resNum = _resourceSet->getResNum();
     // exit
     _exitSet = _pastWorldLevel->getExit();
@@ -342,20 +354,103 @@ void GamePlayController::loadLevel(){
     _wallSetPresent = _presentWorldLevel->getWall();
     _shadowSetPresent = _presentWorldLevel->getShadow();
     _shadowSetPast->updateTransparency();
-    auto pastEdges = _pastWorld->getEdges(_scene, _obsSetPast);
-    generatePastMat(_pastWorld->getVertices());
-    for (int i = 0; i < pastEdges.size(); i++){
-        addPastEdge(pastEdges[i].first, pastEdges[i].second);
+    // obstacle queries go through a bucket grid, one level tile per cell,
+    // and most are answered by the obstacle bitmap first; the drawn path
+    // checks its clearance against a distance field
+    _obsSetPast->buildQueries(ObstacleGrid::DEFAULT_CELL_SIZE, _pastWorldLevel->getOccupancyResolution(), DistanceField::DEFAULT_RESOLUTION);
+    _obsSetPresent->buildQueries(ObstacleGrid::DEFAULT_CELL_SIZE, _presentWorldLevel->getOccupancyResolution(), DistanceField::DEFAULT_RESOLUTION);
+    // where the character can land when switching into each world
+    float pastSwitch = _pastWorldLevel->getSwitchResolution();
+    float presentSwitch = _presentWorldLevel->getSwitchResolution();
+    _switchToPast = pastSwitch > 0 ? std::make_shared<SwitchMap>(_pastWorld->getSize(), _obsSetPast->getObstacleBounds(), ItemView::OBSTACLE_MARGIN, pastSwitch) : nullptr;
+    _switchToPresent = presentSwitch > 0 ? std::make_shared<SwitchMap>(_presentWorld->getSize(), _obsSetPresent->getObstacleBounds(), ItemView::OBSTACLE_MARGIN, presentSwitch) : nullptr;
+    // navigation graphs are baked with the level or cached after the first load
+    _pastGraph = _pastWorldLevel->getNavGraph();
+    if (_pastGraph == nullptr) {
+        auto pastEdges = _pastWorld->getEdges(_obsSetPast, _navWorkers.get());
+        _pastGraph = std::make_shared<NavGraph>(_pastWorld->getNodes(), pastEdges);
+        _pastWorldLevel->setNavGraph(_pastGraph);
+    }
+    
+    _presentGraph = _presentWorldLevel->getNavGraph();
+    if (_presentGraph == nullptr) {
+        auto presentEdges = _presentWorld->getEdges(_obsSetPresent, _navWorkers.get());
+        _presentGraph = std::make_shared<NavGraph>(_presentWorld->getNodes(), presentEdges);
+        _presentWorldLevel->setNavGraph(_presentGraph);
+    }
+    
+    // small maps answer every guard query from a first-move table, unless the level paths on a nav mesh
+    _pastMoves = _pastWorldLevel->getFirstMoveTable();
+    if (_pastMoves == nullptr && !_pastWorldLevel->usesNavMesh() && FirstMoveTable::supports(*_pastGraph)) {
+        _pastMoves = std::make_shared<FirstMoveTable>(*_pastGraph, _navWorkers.get());
+        _pastWorldLevel->setFirstMoveTable(_pastMoves);
+    }
+    if (_pastMoves != nullptr) {
+        _pastMoves->report("past");
+    }
+    _presentMoves = _presentWorldLevel->getFirstMoveTable();
+    if (_presentMoves == nullptr && !_presentWorldLevel->usesNavMesh() && FirstMoveTable::supports(*_presentGraph)) {
+        _presentMoves = std::make_shared<FirstMoveTable>(*_presentGraph, _navWorkers.get());
+        _presentWorldLevel->setFirstMoveTable(_presentMoves);
+    }
+    if (_presentMoves != nullptr) {
+        _presentMoves->report("present");
+    }
+    
+    // line of sight between lattice nodes is a bit test; the workers raycast
+    // the obstacle snapshot through its const query at the same time
+    _pastVisibility = _pastWorldLevel->getNodeVisibility();
+    if (_pastVisibility == nullptr && !_pastWorldLevel->usesNavMesh() && NavVisibility::supports(*_pastGraph)) {
+        _obsSetPast->updateObstacles();
+        std::shared_ptr<const ItemSetController> obs = _obsSetPast;
+        CUAssertLog(obs->obstaclesReady(), "the past obstacles changed before the visibility build");
+        _pastVisibility = std::make_shared<NavVisibility>(*_pastGraph, [obs](const Vec2& a, const Vec2& b) {
+            return obs->segmentInObstacle(a, b);
+        }, _navWorkers.get());
+        _pastWorldLevel->setNodeVisibility(_pastVisibility);
+    }
+    if (_pastVisibility != nullptr) {
+        _pastVisibility->report("past");
     }
+    _presentVisibility = _presentWorldLevel->getNodeVisibility();
+    if (_presentVisibility == nullptr && !_presentWorldLevel->usesNavMesh() && NavVisibility::supports(*_presentGraph)) {
+        _obsSetPresent->updateObstacles();
+        std::shared_ptr<const ItemSetController> obs = _obsSetPresent;
+        CUAssertLog(obs->obstaclesReady(), "the present obstacles changed before the visibility build");
+        _presentVisibility = std::make_shared<NavVisibility>(*_presentGraph, [obs](const Vec2& a, const Vec2& b) {
+            return obs->segmentInObstacle(a, b);
+        }, _navWorkers.get());
+        _presentWorldLevel->setNodeVisibility(_presentVisibility);
+    }
+    if (_presentVisibility != nullptr) {
+        _presentVisibility->report("present");
+    }
+    
+    // larger maps are searched hierarchically
+    _pastHierarchy = _pastMoves == nullptr && !_pastWorldLevel->usesNavMesh() && _pastGraph->size() >= NavHierarchy::MIN_NODES ? std::make_shared<NavHierarchy>(*_pastGraph) : nullptr;
+    _presentHierarchy = _presentMoves == nullptr && !_presentWorldLevel->usesNavMesh() && _presentGraph->size() >= NavHierarchy::MIN_NODES ? std::make_shared<NavHierarchy>(*_presentGraph) : nullptr;
     
-    auto presentEdges = _presentWorld->getEdges(_other_scene, _obsSetPresent);
-    generatePresentMat(_presentWorld->getVertices());
-    for (int i = 0; i < presentEdges.size(); i++){
-        addPresentEdge(presentEdges[i].first, presentEdges[i].second);
+    _pastPaths = std::make_shared<PathService>(_navWorkers, _pastGraph, _pastHierarchy, _pastMoves);
+    _presentPaths = std::make_shared<PathService>(_navWorkers, _presentGraph, _presentHierarchy, _presentMoves);
+    
+    // levels can select a nav mesh of the free space around the obstacles instead
+    _pastMesh = nullptr;
+    if (_pastWorldLevel->usesNavMesh()) {
+        _pastMesh = std::make_shared<NavMesh>(Rect(Vec2::ZERO, _pastWorld->getSize()), _obsSetPast->getObstacleBounds(), ItemView::OBSTACLE_MARGIN);
+        CULog("Nav mesh past: %d cells", _pastMesh->size());
+    }
+    _presentMesh = nullptr;
+    if (_presentWorldLevel->usesNavMesh()) {
+        _presentMesh = std::make_shared<NavMesh>(Rect(Vec2::ZERO, _presentWorld->getSize()), _obsSetPresent->getObstacleBounds(), ItemView::OBSTACLE_MARGIN);
+        CULog("Nav mesh present: %d cells", _presentMesh->size());
     }
     
-    _guardSetPast = std::make_unique<GuardSetController>(_assets, _actions, _pastWorld, _obsSetPast, pastMatrix, _pastWorld->getNodes());
-    _guardSetPresent = std::make_unique<GuardSetController>(_assets, _actions, _presentWorld, _obsSetPresent, presentMatrix, _presentWorld->getNodes());
+    _guardSetPast = std::make_unique<GuardSetController>(_assets, _entityActions, _pastWorld, _obsSetPast, _pastGraph, _pastPaths);
+    _guardSetPresent = std::make_unique<GuardSetController>(_assets, _entityActions, _presentWorld, _obsSetPresent, _presentGraph, _presentPaths);
+    _guardSetPast->setNavMesh(_pastMesh);
+    _guardSetPresent->setNavMesh(_presentMesh);
+    _guardSetPast->setNodeVisibility(_pastVisibility);
+    _guardSetPresent->setNodeVisibility(_presentVisibility);
     
     // get guard positions
     _pastMovingGuardsPos = _pastWorldLevel->getMovingGuardsPos();
@@ -400,6 +495,7 @@ void GamePlayController::init(){
     
     // dispose all active actions
     _actions->dispose();
+    _entityActions->dispose();
     // _action_world_switch->dispose();
     _camManager->dispose();
     
@@ -429,18 +525,16 @@ void GamePlayController::init(){
     _UI_scene->addChild(_world_switch_node);
     _isSwitching = false;
 
-    auto edges = _pastWorld->getEdges(_scene, _obsSetPast);
-    generatePastMat(_pastWorld->getVertices());
-    for (int i = 0; i < edges.size(); i++){
-        addPastEdge(edges[i].first, edges[i].second);
-    }
-    
+    // the items share their controllers with the level, so they reserve
+    // their handles again after the dispose above
     _artifactSet->clearSet();
     _artifactSet = _pastWorldLevel->getItem();
+    _artifactSet->setAction(_entityActions);
     _artifactSet->addChildTo(_ordered_root);
 
     _resourceSet->clearSet();
     _resourceSet = _pastWorldLevel->getResources();
+    _resourceSet->setAction(_entityActions);
     _resourceSet->addChildTo(_ordered_root);
 
     _obsSetPast->addChildTo(_ordered_root);
@@ -453,12 +547,6 @@ void GamePlayController::init(){
 //    _shadowSetPresent->addChildTo(_other_ordered_root);
     _obsSetPresent->setVisibility(false); // set to 'true' for debugging only!
 //    _obsSetPresent->setVisibility(true); // set to 'true' for debugging only!
-    auto presentEdges = _presentWorld->getEdges(_other_scene, _obsSetPresent);
-    generatePresentMat(_presentWorld->getVertices());
-    for (int i = 0; i < presentEdges.size(); i++){
-        addPresentEdge(presentEdges[i].first, presentEdges[i].second);
-    }
-    
     _activeMap = "pastWorld";
     _pastWorld->setActive(true);
     _presentWorld->setActive(false);
@@ -470,8 +558,12 @@ void GamePlayController::init(){
     //_character->addChildTo(_scene);
     _character->addChildTo(_ordered_root);
     
-    _guardSetPast = std::make_unique<GuardSetController>(_assets, _actions, _pastWorld, _obsSetPast, pastMatrix, _pastWorld->getNodes());
-    _guardSetPresent = std::make_unique<GuardSetController>(_assets, _actions, _presentWorld, _obsSetPresent, presentMatrix, _presentWorld->getNodes());
+    _guardSetPast = std::make_unique<GuardSetController>(_assets, _entityActions, _pastWorld, _obsSetPast, _pastGraph, _pastPaths);
+    _guardSetPresent = std::make_unique<GuardSetController>(_assets, _entityActions, _presentWorld, _obsSetPresent, _presentGraph, _presentPaths);
+    _guardSetPast->setNavMesh(_pastMesh);
+    _guardSetPresent->setNavMesh(_presentMesh);
+    _guardSetPast->setNodeVisibility(_pastVisibility);
+    _guardSetPresent->setNodeVisibility(_presentVisibility);
     
     _guardSetPast->clearSet();
     _guardSetPresent->clearSet();
@@ -484,6 +576,10 @@ void GamePlayController::init(){
     // generate guards in present world
     generateMovingGuards(_presentMovingGuardsPos, false);
     generateStaticGuards(_presentStaticGuardsPos, false);
+    
+    // stress levels add many more patrolling guards to both worlds
+    generateStressGuards(_pastWorldLevel->getStressGuards(), _pastGraph, true);
+    generateStressGuards(_presentWorldLevel->getStressGuards(), _presentGraph, false);
 
 
     _path = make_unique<PathController>(_assets);
@@ -652,7 +748,7 @@ void GamePlayController::update(float dt){
 
     _input->update(dt);
     // if pinch, switch world
-    _cantSwitch = ((_activeMap == "pastWorld" && _obsSetPresent->inObstacle(_character->getPosition())) || (_activeMap == "presentWorld" && _obsSetPast->inObstacle(_character->getPosition())));
+    _cantSwitch = switchBlocked(_character->getPosition());
     
 
     _cantSwitch = _cantSwitch || (_character->getNumRes() == 0);
@@ -766,7 +862,11 @@ void GamePlayController::update(float dt){
                 Vec2 worldSize = _pastWorld->getSize();
                 bool withinMap = (checkpoint.x >= 0) && (checkpoint.x <= worldSize.x) && (checkpoint.y >= 0) && (checkpoint.y <= worldSize.y);
                 
-                if((_path->getPath().size() == 0 && _activeMap == "pastWorld" && _obsSetPast->inObstacle(checkpoint)) || (_path->getPath().size() == 0 && _activeMap == "presentWorld" && _obsSetPresent->inObstacle(checkpoint))){
+                // the whole step from the last checkpoint is checked, so a fast
+                // swipe cannot skip over a thin wall
+                std::shared_ptr<ItemSetController> obsSet = _activeMap == "pastWorld" ? _obsSetPast : _obsSetPresent;
+                
+                if(_path->getPath().size() == 0 && obsSet->circleInObstacle(checkpoint, PATH_CLEARANCE)){
                     // pan
                     _isPanning = true;
                     _path->setIsDrawing(false);
@@ -781,7 +881,7 @@ void GamePlayController::update(float dt){
                     
                 }
     
-                else if((_activeMap == "pastWorld" && _obsSetPast->inObstacle(checkpoint)) || (_activeMap == "presentWorld" && _obsSetPresent->inObstacle(checkpoint))){
+                else if(obsSet->sweptCircleInObstacle(_path->getLastPos(), checkpoint, PATH_CLEARANCE)){
                     // don't want the path drawing be canceled if tap on a wall
                     // _path->setIsDrawing(false);
                     break;
@@ -968,6 +1068,8 @@ void GamePlayController::update(float dt){
         Path2 bound = pathFact.makeCircle(_previewNode->getPosition(), PREVIEW_RADIUS);
         _previewBound->setPath(bound);
         _previewBound->setPosition(_previewNode->getPosition());
+        // the outline turns red where the character could not land
+        _previewBound->setColor(switchBlocked(_previewNode->getPosition()) ? Color4::RED : Color4::WHITE);
         
     }
     
@@ -1022,90 +1124,108 @@ void GamePlayController::update(float dt){
     _artifactSet->updateAnim();
     _resourceSet->updateAnim();
     
+    // the item and guard trees hand out the candidates near the character
+    Rect reach = _character->getReach();
+    
     // if collect a resource
     if(_activeMap == "pastWorld"){
         // artifact
-        for(int i=0; i<_artifactSet->_itemSet.size(); i++){
+        int collected = -1;
+        _artifactSet->queryItems(reach, [this, &collected](int i) {
             // detect collision
             if( _artifactSet->_itemSet[i]->Iscollectable() && _character->containsFar(_artifactSet->_itemSet[i]->getNodePosition())){
-                // if close, should collect it
-                if (_artifactSet->_itemSet[i]->isArtifact()){
-                    AudioEngine::get()->play("artifact", _collectArtifactSound, false, _collectArtifactSound->getVolume(), true);
-                    _character->addArt();
-                    // tutorial
-                    if(level == 1){
-                        _tutorial_name = "1_2";
-                        // make character stop moving
-                        stopCharacter();
-                        
-                    }
+                collected = i;
+                return false;
+            }
+            return true;
+        });
+        if(collected != -1){
+            int i = collected;
+            // if close, should collect it
+            if (_artifactSet->_itemSet[i]->isArtifact()){
+                AudioEngine::get()->play("artifact", _collectArtifactSound, false, _collectArtifactSound->getVolume(), true);
+                _character->addArt();
+                // tutorial
+                if(level == 1){
+                    _tutorial_name = "1_2";
+                    // make character stop moving
+                    stopCharacter();
+                    
                 }
-                // make the artifact disappear and remove from set
-                _artifactSet->remove_this(i, _ordered_root);
-                break;
             }
+            // make the artifact disappear and remove from set
+            _artifactSet->remove_this(i, _ordered_root);
         }
         
         // resource
-        for(int i=0; i<_resourceSet->_itemSet.size(); i++){
+        collected = -1;
+        _resourceSet->queryItems(reach, [this, &collected](int i) {
             // detect collision
             if( _resourceSet->_itemSet[i]->Iscollectable() && _character->containsFar(_resourceSet->_itemSet[i]->getNodePosition())){
-                // if close, should collect it
-                if(_resourceSet->_itemSet[i]->isResource()){
-                    AudioEngine::get()->play("resource", _collectResourceSound, false, _collectResourceSound->getVolume(), true);
-                    _character->addRes();
-                }
-                // make the artifact disappear and remove from set
-                _resourceSet->remove_this(i, _ordered_root);
-                break;
+                collected = i;
+                return false;
+            }
+            return true;
+        });
+        if(collected != -1){
+            int i = collected;
+            // if close, should collect it
+            if(_resourceSet->_itemSet[i]->isResource()){
+                AudioEngine::get()->play("resource", _collectResourceSound, false, _collectResourceSound->getVolume(), true);
+                _character->addRes();
             }
+            // make the artifact disappear and remove from set
+            _resourceSet->remove_this(i, _ordered_root);
         }
         
     }
 
 #pragma mark Guard Methods
-    _guardSetPast->patrol(_character->getNodePosition(), _character->getAngle(), _scene, "past");
-    _guardSetPresent->patrol(_character->getNodePosition(), _character->getAngle(), _other_scene, "present");
+    _guardSetPast->patrol(_character->getNodePosition(), _character->getAngle(), _scene, dt);
+    _guardSetPresent->patrol(_character->getNodePosition(), _character->getAngle(), _other_scene, dt);
     // if collide with guard
+    bool caught = false;
+    reach = _character->getReach();
     if(_activeMap == "pastWorld"){
-        for(int i=0; i<_guardSetPast->_guardSet.size(); i++){
-            if(_character->containsNear(_guardSetPast->_guardSet[i]->getNodePosition())){
-                failTerminate();
-                break;
-            }
+        _guardSetPast->queryGuards(reach, [this, &caught](int i) {
+            caught = _character->containsNear(_guardSetPast->getPosition(i));
 //            if(_obsSetPast->inObstacle(_guardSetPast->_guardSet[i]->getNodePosition())){
 //                // guard stop
 //            }
-        }
+            return !caught;
+        });
     }
     
     else{
-        for(int i=0; i<_guardSetPresent->_guardSet.size(); i++){
-            if(_character->containsNear(_guardSetPresent->_guardSet[i]->getNodePosition())){
-                failTerminate();
-                break;
-            }
-        }
+        _guardSetPresent->queryGuards(reach, [this, &caught](int i) {
+            caught = _character->containsNear(_guardSetPresent->getPosition(i));
+            return !caught;
+        });
+    }
+    if(caught){
+        failTerminate();
     }
     
 #pragma mark Exit Method
 
     if(_activeMap == "pastWorld"){
-        for(int i=0; i<_exitSet->_itemSet.size(); i++){
+        bool exited = false;
+        _exitSet->queryItems(reach, [this, &exited](int i) {
             // detect collision
             if( _character->containsFar(_exitSet->_itemSet[i]->getNodePosition())){
-                if(_character->getNumArt() == artNum){
-                    completeTerminate();
-                    break;
-                }
+                exited = _character->getNumArt() == artNum;
             }
-            
+            return !exited;
+        });
+        if(exited){
+            completeTerminate();
         }
         
     }
     
     // Animate
     _actions->update(dt);
+    _entityActions->update(dt);
     _camManager->update(dt);
     
     // the camera is moving smoothly, but the UI only set its movement per frame
@@ -1144,6 +1264,48 @@ void GamePlayController::update(float dt){
         }
     }
 
+    void GamePlayController::generateStressGuards(int count, const std::shared_ptr<NavGraph>& graph, bool isPast) {
+        if (count <= 0 || graph == nullptr) {
+            return;
+        }
+        // every guard walks back and forth between a node and one of its neighbours
+        std::vector<int> nodes;
+        for (int u = 0; u < graph->size(); u++) {
+            if (graph->degree(u) > 0) {
+                nodes.push_back(u);
+            }
+        }
+        if (nodes.empty()) {
+            return;
+        }
+        // a fixed seed spawns the same guards every run, so the timings compare
+        std::mt19937 randoms(isPast ? 1 : 2);
+        for (int k = 0; k < count; k++) {
+            int u = nodes[randoms() % nodes.size()];
+            int v = graph->neighborsBegin(u)[randoms() % graph->degree(u)];
+            Vec2 a = graph->position(u);
+            Vec2 b = graph->position(v);
+            addMovingGuard(a.x, a.y, {a, b}, isPast);
+        }
+        CULog("Stress guards %s: %d", isPast ? "past" : "present", count);
+        GuardSetController* guards = isPast ? _guardSetPast.get() : _guardSetPresent.get();
+#ifdef GUARD_STRESS
+        // time the full update, with the character circling the middle of the graph
+        Vec2 low = graph->position(nodes[0]);
+        Vec2 high = low;
+        for (int u : nodes) {
+            Vec2 p = graph->position(u);
+            low.set(std::min(low.x, p.x), std::min(low.y, p.y));
+            high.set(std::max(high.x, p.x), std::max(high.y, p.y));
+        }
+        float radius = std::min(high.x - low.x, high.y - low.y) / 4;
+        GuardBenchmark::Result result = GuardBenchmark::run(*guards, (low + high) / 2, radius, STRESS_REPORT_FRAMES);
+        CULog("Guard benchmark %s: %d guards, simulation %.3f ms, views %.3f ms per frame, %d alerted guard frames",
+              isPast ? "past" : "present", result.guards, result.simMillis, result.syncMillis, result.alerted);
+#endif
+        guards->setReportInterval(STRESS_REPORT_FRAMES);
+    }
+
     
 #pragma mark -
 #pragma mark Helpers
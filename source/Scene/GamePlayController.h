@@ -104,11 +104,30 @@ public:
 
     /** Manager to process the animation actions */
     std::shared_ptr<cugl::scene2::ActionManager> _actions;
+    /** Manager for the actions of the guards and items, by handle */
+    std::shared_ptr<ActionSlots> _entityActions;
     std::shared_ptr<cugl::scene2::MoveTo> _moveTo;
 
-    /**adjacency matrix*/
-    bool** pastMatrix;
-    bool** presentMatrix;
+    /** navigation graphs used by the guards of each world */
+    std::shared_ptr<NavGraph> _pastGraph;
+    std::shared_ptr<NavGraph> _presentGraph;
+    /** cluster abstractions of the graphs for hierarchical search, nullptr on small maps */
+    std::shared_ptr<NavHierarchy> _pastHierarchy;
+    std::shared_ptr<NavHierarchy> _presentHierarchy;
+    /** first-move tables of the graphs, nullptr on maps too large for one */
+    std::shared_ptr<FirstMoveTable> _pastMoves;
+    std::shared_ptr<FirstMoveTable> _presentMoves;
+    /** node visibility matrices of the graphs, nullptr on nav mesh levels */
+    std::shared_ptr<NavVisibility> _pastVisibility;
+    std::shared_ptr<NavVisibility> _presentVisibility;
+    /** worker threads for guard path searches, kept for the whole session */
+    std::shared_ptr<ThreadPool> _navWorkers;
+    /** asynchronous path searches on each world's graph */
+    std::shared_ptr<PathService> _pastPaths;
+    std::shared_ptr<PathService> _presentPaths;
+    /** nav meshes of levels that select one, nullptr otherwise */
+    std::shared_ptr<NavMesh> _pastMesh;
+    std::shared_ptr<NavMesh> _presentMesh;
     
     /**manager to process camera actions**/
     std::shared_ptr<CameraManager> _camManager;
@@ -144,6 +163,15 @@ public:
     // two_world switch
 
     bool _cantSwitch = false;
+    /** where the character can land when switching into each world, nullptr to always test the obstacles */
+    std::shared_ptr<SwitchMap> _switchToPast;
+    std::shared_ptr<SwitchMap> _switchToPresent;
+    /** what the inventory bars show, so they are only re-textured when it changes */
+    int _shownArt = -1;
+    int _shownArtTotal = -1;
+    int _shownRes = -1;
+    bool _shownHalf = false;
+    bool _shownCantSwitch = false;
     // if two-world switch is in progress
     bool _isSwitching;
     // first half: collapse
@@ -258,36 +286,6 @@ public:
     
     void generateResource();
     
-    void generatePastMat(int vertices){
-        pastMatrix = new bool*[vertices];
-        
-        for (int i = 0; i < vertices; i++) {
-          pastMatrix[i] = new bool[vertices];
-          for (int j = 0; j < vertices; j++)
-            pastMatrix[i][j] = false;
-        }
-    }
-    
-    void generatePresentMat(int vertices){
-        presentMatrix = new bool*[vertices];
-        
-        for (int i = 0; i < vertices; i++) {
-          presentMatrix[i] = new bool[vertices];
-          for (int j = 0; j < vertices; j++)
-            presentMatrix[i][j] = false;
-        }
-    }
-    
-    void addPastEdge(int i, int j) {
-        pastMatrix[i][j] = true;
-        pastMatrix[j][i] = true;
-    }
-    
-    void addPresentEdge(int i, int j) {
-        presentMatrix[i][j] = true;
-        presentMatrix[j][i] = true;
-    }
-
     void failTerminate(){
         _tutorial_name = "";
         AudioEngine::get()->play("lost", _loseSound, false, _loseSound->getVolume(), true);
@@ -340,6 +338,12 @@ public:
     void generateMovingGuards(std::vector<std::vector<cugl::Vec2>> movingGuardsPos, bool isPast);
     void generateStaticGuards(std::vector<std::vector<int>> staticGuardsPos, bool isPast);
 
+    /**
+     * Adds `count` patrolling guards on random edges of the graph, to
+     * measure the guard update with many guards.
+     */
+    void generateStressGuards(int count, const std::shared_ptr<NavGraph>& graph, bool isPast);
+
     
     void updateRenderPriority(){
         // both orderedRoot
@@ -360,10 +364,39 @@ public:
         _guardSetPresent->updatePriority();
     }
     
+    /**
+     * Returns true if an obstacle of the other world stands at `pos`.
+     *
+     * Most positions are answered by the switch map of the other world;
+     * only the ones along its obstacle borders test the obstacles.
+     */
+    bool switchBlocked(Vec2 pos){
+        bool toPresent = _activeMap == "pastWorld";
+        std::shared_ptr<SwitchMap> map = toPresent ? _switchToPresent : _switchToPast;
+        SwitchMap::Result result = map != nullptr ? map->test(pos) : SwitchMap::Result::UNSURE;
+        if (result != SwitchMap::Result::UNSURE) {
+            return result == SwitchMap::Result::BLOCKED;
+        }
+        return toPresent ? _obsSetPresent->inObstacle(pos) : _obsSetPast->inObstacle(pos);
+    }
+    
     void updateInventoryPanel(){
         // art
         int cur_art = _character->getNumArt();
         int total_art = artNum;
+        // if at the present world, draw the last bar with transparency
+        bool half_switch = _activeMap == "presentWorld";
+        int cur_res = _character->getNumRes();
+        if (cur_art == _shownArt && total_art == _shownArtTotal && cur_res == _shownRes &&
+            half_switch == _shownHalf && _cantSwitch == _shownCantSwitch) {
+            return;
+        }
+        _shownArt = cur_art;
+        _shownArtTotal = total_art;
+        _shownRes = cur_res;
+        _shownHalf = half_switch;
+        _shownCantSwitch = _cantSwitch;
+        
         for(int i=0; i<7; i++){
             if(i < cur_art){
                 _art_bar_vec[i]->setTexture(_assets->get<Texture>("inventory_artifact_filled_bar"));
@@ -377,10 +410,6 @@ public:
                 _art_bar_vec[i]->setVisible(false);
             }
         }
-        // if at the present world, draw the last bar with transparency
-        bool half_switch = _activeMap == "presentWorld";
-        int cur_res = _character->getNumRes();
-        
         std::string resource_trans_bar;
         std::string resource_bar;
         if(_cantSwitch){
@@ -278,7 +278,18 @@ public:
         _model->setActive(active);
     }
     
-    std::vector<std::pair<int,int>> getEdges(const std::shared_ptr<cugl::Scene2>& scene, std::shared_ptr<ItemSetController> obsSet){
+    /**
+     * Returns the edges of the navigation lattice over this map.
+     *
+     * Neighbouring lattice nodes are joined unless the segment between them
+     * is blocked by an obstacle. All segments are tested in one batch by
+     * `ItemSetController::linesInObstacle`, which deals them out to the
+     * workers of `pool` in words of 64 segments, interleaved by worker.
+     *
+     * @param obsSet    The obstacles of this world
+     * @param pool      Worker threads for the segment tests, or nullptr
+     */
+    std::vector<std::pair<int,int>> getEdges(std::shared_ptr<ItemSetController> obsSet, ThreadPool* pool = nullptr){
         std::unordered_map<int, Vec2> nodes;
         std::vector<std::pair<int,int>> edges;
         int count = 0;
@@ -301,69 +312,33 @@ public:
             }
         }
         
-        SplinePather splinePather = SplinePather();
-        SimpleExtruder extruder = SimpleExtruder();
-        
+        // every candidate edge, the ones along the rows first
+        std::vector<std::pair<int,int>> candidates;
         for (int i = 0; i < count - 1; i++){
             if ( (i+1) % (numPerRow) != 0){
-                Vec2 a = nodes[i];
-                Vec2 b = nodes[i + 1];
-                bool hitObs = obsSet->lineInObstacle(a, b);
-                
-                if (hitObs == false){
-                    edges.push_back(std::make_pair(i, i+1));
-                }
-                /*
-                Spline2 spline = Spline2(a, b);
-                splinePather.set(&spline);
-                splinePather.calculate();
-                
-                extruder.set(splinePather.getPath());
-                extruder.calculate(1);
-                Poly2 line = extruder.getPolygon();
-                
-                std::shared_ptr<scene2::PolygonNode> polyNode= scene2::PolygonNode::alloc();
-                polyNode->setPolygon(line);
-                if (hitObs){
-                    polyNode->setColor(Color4::RED);
-                }
-                polyNode->setPosition(a.getMidpoint(b));
-                scene->addChild(polyNode);
-                */
-                 
+                candidates.push_back(std::make_pair(i, i+1));
             }
-            
         }
-        
         for (int i = 0; i < count - numPerRow; i++){
-            splinePather.clear();
-            extruder.clear();
-            
-            Vec2 a = nodes[i];
-            Vec2 b = nodes[i + numPerRow];
-            bool hitObs = obsSet->lineInObstacle(a, b);
-            
+            candidates.push_back(std::make_pair(i, i + numPerRow));
+        }
+        
+        std::vector<Vec2> starts;
+        std::vector<Vec2> ends;
+        starts.reserve(candidates.size());
+        ends.reserve(candidates.size());
+        for (auto& edge : candidates){
+            starts.push_back(nodes[edge.first]);
+            ends.push_back(nodes[edge.second]);
+        }
+        std::vector<uint64_t> hits;
+        obsSet->linesInObstacle(starts, ends, hits, pool);
+        
+        for (int k = 0; k < candidates.size(); k++){
+            bool hitObs = (hits[k / 64] >> (k % 64)) & 1;
             if (hitObs == false){
-                edges.push_back(std::make_pair(i, i + numPerRow));
+                edges.push_back(candidates[k]);
             }
-            /*
-            Spline2 spline = Spline2(a, b);
-            splinePather.set(&spline);
-            splinePather.calculate();
-            
-            extruder.set(splinePather.getPath());
-            extruder.calculate(1);
-            Poly2 line = extruder.getPolygon();
-            
-            std::shared_ptr<scene2::PolygonNode> polyNode= scene2::PolygonNode::alloc();
-            polyNode->setPolygon(line);
-            if (hitObs){
-                polyNode->setColor(Color4::RED);
-            }
-            polyNode->setPosition(a.getMidpoint(b));
-            scene->addChild(polyNode);
-            */
-            
         }
         
         _vertices = count;